@@ -27,6 +27,9 @@
  // Dalton Altstaetter - DEA528 February 3, 2015
 #include <stdint.h>
 #include "tm4c123gh6pm.h"
+#include "TIMER.h"
+#include "ADC.h"
+#include "PLL.h"
 #define NVIC_EN0_INT17          0x00020000  // Interrupt 17 enable
 
 #define TIMER_CFG_16_BIT        0x00000004  // 16-bit timer configuration,
@@ -69,8 +72,8 @@
 
 void DisableInterrupts(void); // Disable interrupts
 void EnableInterrupts(void);  // Enable interrupts
-long StartCritical (void);    // previous I bit, disable interrupts
-void EndCritical(long sr);    // restore I bit to previous value
+int32_t StartCritical (void); // previous I bit, disable interrupts
+void EndCritical(int32_t sr); // restore I bit to previous value
 void WaitForInterrupt(void);  // low power mode
 
 // There are many choices to make when using the ADC, and many
@@ -116,10 +119,18 @@ void (*ADC_Task)(unsigned long);
 volatile uint32_t NumberOfSamples=0;
 volatile uint16_t* Buffer;
 volatile uint32_t Status=1;
-//void ADC_Collect(uint8_t channelNum, uint32_t fs, uint16_t buffer[],uint32_t numberOfSamples){
-void ADC_Collect(uint8_t channelNum, uint32_t fs, void(*task)(unsigned long)){
+uint32_t Decimation=1;           // ADC_Collect samples averaged per task call
+uint32_t DecimateSum, DecimateCount;
+extern uint16_t *DMABufA;        // uDMA mode of sequencer 3, see ADC_CollectDMA
+#define DMACHANNEL 17            // uDMA channel 17 is ADC0 SS3
+#define DMACHBIT (1<<DMACHANNEL)
+
+// ******** ADC_PinInit ************
+// turn the pin of one analog input channel into an analog input
+// Input: channel 0 to 11
+// Output: 1 if successful, 0 if the channel does not exist
+static int ADC_PinInit(uint32_t channelNum){
   volatile uint32_t delay;
-  // **** GPIO pin initialization ****
   switch(channelNum){             // 1) activate clock
     case 0:
     case 1:
@@ -136,7 +147,7 @@ void ADC_Collect(uint8_t channelNum, uint32_t fs, void(*task)(unsigned long)){
     case 10:
     case 11:                      //    these are on GPIO_PORTB
       SYSCTL_RCGCGPIO_R |= SYSCTL_RCGCGPIO_R1; break;
-    default: return;              //    0 to 11 are valid channels on the LM4F120
+    default: return 0;            //    0 to 11 are valid channels on the LM4F120
   }
   delay = SYSCTL_RCGCGPIO_R;      // 2) allow time for clock to stabilize
   delay = SYSCTL_RCGCGPIO_R;
@@ -214,43 +225,433 @@ void ADC_Collect(uint8_t channelNum, uint32_t fs, void(*task)(unsigned long)){
       GPIO_PORTB_AMSEL_R |= 0x20; // 6.11) enable analog functionality on PB5
       break;
   }
-  DisableInterrupts();
+  return 1;
+}
+
+// ******** Seq3_Init ************
+// Timer0A triggered sampling of one channel on ADC0 sequencer 3, the timer
+// is left off and the sequencer interrupt masked for the caller to choose
+// period is in bus cycles, a new one written to TAILR later only takes
+// effect at the next timeout (TAILD), so the rate can change between samples
+// returns 1 if successful, 0 if a periodic thread has Timer0
+// must be called with interrupts disabled
+uint32_t Seq3Timer;             // 1 while the ADC holds Timer0A
+static int Seq3_Init(uint8_t channelNum, uint32_t period){
+  volatile uint32_t delay;
+  if(!Seq3Timer){
+    if(TIMER_Reserve(0) < 0){   // Timer0A belongs to the ADC trigger now
+      return 0;
+    }
+    Seq3Timer = 1;
+  }
   SYSCTL_RCGCADC_R |= 0x01;     // activate ADC0 
   SYSCTL_RCGCTIMER_R |= 0x01;   // activate timer0 
   delay = SYSCTL_RCGCTIMER_R;   // allow time to finish activating
   TIMER0_CTL_R = 0x00000000;    // disable timer0A during setup
   TIMER0_CTL_R |= 0x00000020;   // enable timer0A trigger to ADC
   TIMER0_CFG_R = 0;             // configure for 32-bit timer mode
-  TIMER0_TAMR_R = 0x00000002;   // configure for periodic mode, default down-count settings
+  TIMER0_TAMR_R = TIMER_TAMR_TAILD|0x00000002; // periodic, down-count, reload at timeout
   TIMER0_TAPR_R = 0;            // prescale value for trigger
-  TIMER0_TAILR_R = 80000000/fs-1;    // start value for trigger assuming 80 MHz
+  TIMER0_TAILR_R = period-1;    // start value for trigger
 																 
   TIMER0_IMR_R = 0x00000000;    // disable all interrupts
-  TIMER0_CTL_R |= 0x00000001;   // enable timer0A 32-b, periodic, no interrupts
   ADC0_PC_R = 0x01;         // configure for 125K samples/sec
   ADC0_SSPRI_R = 0x3210;    // sequencer 0 is highest, sequencer 3 is lowest
   ADC0_ACTSS_R &= ~0x08;    // disable sample sequencer 3
   ADC0_EMUX_R = (ADC0_EMUX_R&0xFFFF0FFF)+0x5000; // timer trigger event
   ADC0_SSMUX3_R = channelNum;
   ADC0_SSCTL3_R = 0x06;          // set flag and end                       
-  ADC0_IM_R |= 0x08;             // enable SS3 interrupts
+  ADC0_IM_R &= ~0x08;            // SS3 interrupts are up to the caller
+  ADC0_ISC_R = 0x08;
   ADC0_ACTSS_R |= 0x08;          // enable sample sequencer 3
   NVIC_PRI4_R = (NVIC_PRI4_R&0xFFFF00FF)|0x00004000; //priority 2
   NVIC_EN0_R = 1<<17;              // enable interrupt 17 in NVIC
-	ADC_Task = task;
-  EnableInterrupts();
+  return 1;
+}
+
+// give Timer0A back once sequencer 3 stops sampling
+// must be called with interrupts disabled
+static void Seq3_Free(void){
+  if(Seq3Timer){
+    TIMER_TimerFree(0);         // stops it, periodic threads may have it now
+    Seq3Timer = 0;
+  }
+}
+
+// the sampling session of sequencer 3, opened once by ADC_SessionOpen,
+// after that the rate, channel and trigger change without setting the
+// ADC up again, a new rate goes through TAILD, a new channel or trigger
+// is staged and the SS3 interrupt applies it right after the sample that
+// was converting, so no sample is taken half way through a change
+#define SESSION_CHANNEL 0x01    // Changes bits
+#define SESSION_TRIGGER 0x02
+struct adcsession{
+  volatile uint32_t Open; // 1 while sampling after ADC_SessionOpen, 0 once stopped or under ADC_CollectDMA
+  uint32_t Period;        // bus cycles between timer triggers
+  uint32_t Trigger;       // ADC_TRIGGER_TIMER or ADC_TRIGGER_SOFTWARE
+  uint8_t Channel;
+  uint8_t NextChannel;    // staged until the SS3 interrupt
+  uint32_t NextTrigger;
+  volatile uint32_t Changes;  // SESSION_ bits waiting for a sample boundary
+  volatile uint32_t Busy;     // a software triggered sample is converting
+};
+typedef struct adcsession ADCSessionType;
+ADCSessionType Session;
+
+// nearest period in bus cycles for fs, and the rate it gives in 0.001 Hz
+// 0 if PLL_BusClock can not tell the clock or fs is too fast for it
+static uint32_t Session_Period(uint32_t fs, unsigned long *achieved){
+  unsigned long clock = PLL_BusClock();
+  uint32_t period = (clock+fs/2)/fs;
+  if(period < 2){
+    if(achieved != NULL){
+      *achieved = 0;
+    }
+    return 0;
+  }
+  if(achieved != NULL){
+    *achieved = (unsigned long)(((unsigned long long)clock*1000+period/2)/period);
+  }
+  return period;
+}
+
+// put staged changes into the sequencer, which is idle between samples
+// called from the SS3 interrupt or with no sample converting
+static void Session_Apply(void){
+  uint32_t changes = Session.Changes;
+  Session.Changes = 0;
+  if(changes == 0){
+    return;
+  }
+  ADC0_ACTSS_R &= ~0x08;        // disable sample sequencer 3
+  if(changes&SESSION_CHANNEL){
+    Session.Channel = Session.NextChannel;
+    ADC0_SSMUX3_R = Session.Channel;
+    DecimateSum = 0;            // no output mixes two channels
+    DecimateCount = 0;
+  }
+  if(changes&SESSION_TRIGGER){
+    Session.Trigger = Session.NextTrigger;
+    ADC0_EMUX_R = (ADC0_EMUX_R&0xFFFF0FFF)+(Session.Trigger<<12);
+    if(Session.Trigger == ADC_TRIGGER_TIMER){
+      TIMER0_TAV_R = Session.Period-1; // a full period to the first trigger
+      TIMER0_CTL_R |= 0x00000001;
+    }else{
+      TIMER0_CTL_R &= ~0x00000001;     // no point in counting
+    }
+  }
+  ADC0_ACTSS_R |= 0x08;         // enable sample sequencer 3
+}
+
+// stage changes, applied now if nothing is converting
+static void Session_Stage(uint32_t changes){
+  Session.Changes |= changes;
+  if((Session.Trigger == ADC_TRIGGER_SOFTWARE) && !Session.Busy){
+    Session_Apply();
+  }
+}
+
+// end the session when sampling stops, Timer0A stops, SS3 interrupts are
+// masked and staged changes are dropped, so the session calls fail and the
+// next ADC_SessionOpen sets everything up again
+// must be called with interrupts disabled
+static void Session_Stop(void){
+  Seq3_Free();                  // no more triggers
+  ADC0_IM_R &= ~0x08;           // disable SS3 interrupts
+  Session.Open = 0;
+  Session.Changes = 0;
+  Session.Busy = 0;
+}
+
+//------------ADC_SessionOpen------------
+// start sampling one channel on ADC0 sequencer 3 with the Timer0A trigger,
+// a session that is already open changes to the new channel, rate and
+// task at the next sample instead of starting over, one that stopped at
+// the end of its run starts over
+// Input: channel 0 to 11, sampling rate in Hz, up to 125 kHz
+//        task to call with each sample (see ADC_Decimation), from the
+//        ADC0 SS3 interrupt, priority 2
+//        achieved gets the exact rate in 0.001 Hz units, it can be NULL
+// Output: 1 if successful, 0 if the channel or rate is out of range, the
+//         bus clock is not known (see PLL_BusClock) or
+//         Timer0 is in use by a periodic thread
+int ADC_SessionOpen(uint8_t channelNum, uint32_t fs, void(*task)(unsigned long),
+  unsigned long *achieved){
+  int32_t sr;
+  uint32_t period;
+  if((fs == 0) || (fs > 125000) || !ADC_PinInit(channelNum)){
+    return 0;
+  }
+  period = Session_Period(fs, achieved);
+  if(period == 0){
+    return 0;
+  }
+  sr = StartCritical();
+  ADC_Task = task;
+  if(Session.Open){
+    Session.Period = period;
+    TIMER0_TAILR_R = period-1;  // from the next timeout
+    Session.NextChannel = channelNum;
+    Session.NextTrigger = ADC_TRIGGER_TIMER;
+    Session_Stage(SESSION_CHANNEL|SESSION_TRIGGER);
+    EndCritical(sr);
+    return 1;
+  }
+  if(!Seq3_Init(channelNum, period)){
+    EndCritical(sr);
+    return 0;
+  }
+  if(DMABufA != NULL){
+    UDMA_ENACLR_R = DMACHBIT;    // one interrupt per sample, no uDMA
+    DMABufA = NULL;
+  }
+  Session.Open = 1;
+  Session.Period = period;
+  Session.Trigger = ADC_TRIGGER_TIMER;
+  Session.Channel = channelNum;
+  Session.Changes = 0;
+  Session.Busy = 0;
+  DecimateSum = 0;
+  DecimateCount = 0;
+  ADC0_IM_R |= 0x08;             // enable SS3 interrupts
+  TIMER0_CTL_R |= 0x00000001;   // enable timer0A 32-b, periodic, no interrupts
+  EndCritical(sr);
+  return 1;
+}
+
+//------------ADC_SessionRate------------
+// change the sampling rate of the open session, the period being counted
+// finishes first, so there is no short or long sample in between
+// Input: sampling rate in Hz, up to 125 kHz
+//        achieved gets the exact rate in 0.001 Hz units, it can be NULL
+// Output: 1 if successful, 0 if no session is sampling or fs is out of range
+int ADC_SessionRate(uint32_t fs, unsigned long *achieved){
+  int32_t sr;
+  uint32_t period;
+  if((fs == 0) || (fs > 125000)){
+    return 0;
+  }
+  period = Session_Period(fs, achieved);
+  if(period == 0){
+    return 0;
+  }
+  sr = StartCritical();
+  if(!Session.Open){            // checked here, the end of a run can stop it
+    EndCritical(sr);
+    return 0;
+  }
+  Session.Period = period;
+  TIMER0_TAILR_R = period-1;    // TAILD, loaded at the next timeout
+  EndCritical(sr);
+  return 1;
+}
+
+//------------ADC_SessionChannel------------
+// change the channel of the open session from the next sample on
+// Input: channel 0 to 11
+// Output: 1 if successful, 0 if no session is sampling or channel is bad
+int ADC_SessionChannel(uint8_t channelNum){
+  int32_t sr;
+  if(!ADC_PinInit(channelNum)){
+    return 0;
+  }
+  sr = StartCritical();
+  if(!Session.Open){
+    EndCritical(sr);
+    return 0;
+  }
+  Session.NextChannel = channelNum;
+  Session_Stage(SESSION_CHANNEL);
+  EndCritical(sr);
+  return 1;
+}
+
+//------------ADC_SessionTrigger------------
+// choose what starts a sample of the open session, Timer0A at the session
+// rate, or ADC_SessionSample, the timer stops while it is not used
+// Input: ADC_TRIGGER_TIMER or ADC_TRIGGER_SOFTWARE
+// Output: 1 if successful, 0 if no session is sampling or trigger is bad
+int ADC_SessionTrigger(uint32_t trigger){
+  int32_t sr;
+  if((trigger != ADC_TRIGGER_TIMER) && (trigger != ADC_TRIGGER_SOFTWARE)){
+    return 0;
+  }
+  sr = StartCritical();
+  if(!Session.Open){
+    EndCritical(sr);
+    return 0;
+  }
+  Session.NextTrigger = trigger;
+  Session_Stage(SESSION_TRIGGER);
+  EndCritical(sr);
+  return 1;
+}
+
+//------------ADC_SessionSample------------
+// take one sample now under ADC_TRIGGER_SOFTWARE, it goes to the task
+// Input: none
+// Output: 1 if started, 0 if not in software trigger or one is converting
+int ADC_SessionSample(void){
+  int32_t sr;
+  sr = StartCritical();
+  if(!Session.Open || (Session.Trigger != ADC_TRIGGER_SOFTWARE) || Session.Busy){
+    EndCritical(sr);
+    return 0;
+  }
+  Session.Busy = 1;
+  ADC0_PSSI_R = 0x08;           // initiate SS3
+  EndCritical(sr);
+  return 1;
+}
+
+//void ADC_Collect(uint8_t channelNum, uint32_t fs, uint16_t buffer[],uint32_t numberOfSamples){
+// a session on channelNum at fs, see ADC_SessionOpen
+void ADC_Collect(uint8_t channelNum, uint32_t fs, void(*task)(unsigned long)){
+  ADC_SessionOpen(channelNum, fs, task, NULL);
+}
+
+// uDMA streaming of sequencer 3 into two buffers, uDMA channel 17 is
+// ADC0 SS3, the primary control structure fills buffer A and the alternate
+// one buffer B, in ping-pong mode the uDMA switches between them on its
+// own, and the ADC0 SS3 interrupt comes once per finished buffer
+#define DMA_SRCEND  0           // word offsets in a control structure
+#define DMA_DSTEND  1
+#define DMA_CONTROL 2
+// 16-bit items, destination increments, source is the FIFO register
+#define DMA_CONTROL_ADC  0x5D000000
+#define DMA_MODE_M       0x00000007
+#define DMA_MODE_PINGPONG 0x00000003
+#ifdef __CC_ARM
+__align(1024) uint32_t DMAControlTable[256]; // 32 primary then 32 alternate structures
+#else
+uint32_t DMAControlTable[256] __attribute__((aligned(1024)));
+#endif
+uint16_t *DMABufA, *DMABufB;    // NULL while ADC_Collect owns sequencer 3
+uint32_t DMABlockSize;
+void (*ADC_BlockTask)(uint16_t buffer[], uint32_t n);
+
+// point one control structure at buffer for another block
+static void DMA_Arm(uint32_t *control, uint16_t *buffer){
+  control[DMA_SRCEND] = (uint32_t)&ADC0_SSFIFO3_R;
+  control[DMA_DSTEND] = (uint32_t)&buffer[DMABlockSize-1];
+  control[DMA_CONTROL] = DMA_CONTROL_ADC|((DMABlockSize-1)<<4)|DMA_MODE_PINGPONG;
+}
+
+//------------ADC_CollectDMA------------
+// sample one channel at fs Hz into two buffers in turn with the uDMA, so
+// there is one interrupt per block instead of one per sample
+// Input: channel 0 to 11, sampling rate in Hz
+//        two buffers of n samples each, n is 1 to 1024
+//        task to call with each full buffer while the other one fills,
+//        it runs in the ADC0 SS3 interrupt and has n/fs seconds to finish
+// Output: 1 if successful, 0 if the channel or n is out of range or
+//         Timer0 is in use by a periodic thread
+int ADC_CollectDMA(uint8_t channelNum, uint32_t fs, uint16_t bufA[], uint16_t bufB[],
+  uint32_t n, void(*task)(uint16_t buffer[], uint32_t n)){
+  volatile uint32_t delay;
+  uint32_t period;
+  int32_t sr;
+  if((n == 0) || (n > 1024) || !ADC_PinInit(channelNum)){
+    return 0;
+  }
+  if((fs == 0) || (fs > 125000)){
+    return 0;
+  }
+  period = Session_Period(fs, NULL);
+  if(period == 0){
+    return 0;
+  }
+  sr = StartCritical();
+  if(!Seq3_Init(channelNum, period)){
+    EndCritical(sr);
+    return 0;
+  }
+  Session.Open = 0;             // sequencer 3 belongs to the uDMA now
+  SYSCTL_RCGCDMA_R |= 0x01;     // activate the uDMA
+  delay = SYSCTL_RCGCDMA_R;
+  UDMA_CFG_R = 0x01;            // master enable
+  UDMA_CTLBASE_R = (uint32_t)DMAControlTable;
+  UDMA_CHMAP2_R &= ~0x000000F0; // channel 17 is ADC0 SS3
+  UDMA_ENACLR_R = DMACHBIT;     // off while its structures change
+  UDMA_PRIOCLR_R = DMACHBIT;
+  UDMA_ALTCLR_R = DMACHBIT;     // start with the primary structure, buffer A
+  UDMA_USEBURSTCLR_R = DMACHBIT;
+  UDMA_REQMASKCLR_R = DMACHBIT;
+  DMABufA = bufA;
+  DMABufB = bufB;
+  DMABlockSize = n;
+  ADC_BlockTask = task;
+  DMA_Arm(&DMAControlTable[4*DMACHANNEL], bufA);
+  DMA_Arm(&DMAControlTable[4*(32+DMACHANNEL)], bufB);
+  UDMA_ENASET_R = DMACHBIT;
+  UDMA_CHIS_R = DMACHBIT;       // no stale block done
+  ADC0_IM_R |= 0x08;            // a finished block interrupts through SS3
+  TIMER0_CTL_R |= 0x00000001;   // start sampling
+  EndCritical(sr);
+  return 1;
 }
+
+//------------ADC_CollectDMAStop------------
+// stop the sampling started by ADC_CollectDMA, the buffers are free when
+// this returns
+// Input: none
+// Output: none
+void ADC_CollectDMAStop(void){
+  int32_t sr;
+  sr = StartCritical();
+  if(DMABufA != NULL){
+    Seq3_Free();                  // no more triggers
+    UDMA_ENACLR_R = DMACHBIT;
+    ADC0_IM_R &= ~0x08;         // disable SS3 interrupts
+    ADC0_ISC_R = 0x08;
+    UDMA_CHIS_R = DMACHBIT;
+    DMABufA = NULL;
+  }
+  EndCritical(sr);
+}
+
+// a structure whose mode went back to stop has finished its buffer, it is
+// armed again for the block after next and its buffer handed to the task
+static void DMA_Handler(void){
+  uint32_t *primary = &DMAControlTable[4*DMACHANNEL];
+  uint32_t *alternate = &DMAControlTable[4*(32+DMACHANNEL)];
+  if((primary[DMA_CONTROL]&DMA_MODE_M) == 0){
+    DMA_Arm(primary, DMABufA);
+    (*ADC_BlockTask)(DMABufA, DMABlockSize);
+  }
+  if((alternate[DMA_CONTROL]&DMA_MODE_M) == 0){
+    DMA_Arm(alternate, DMABufB);
+    (*ADC_BlockTask)(DMABufB, DMABlockSize);
+  }
+}
+
 volatile uint32_t ADCvalue;
 void ADC0Seq3_Handler(void){
 	static int i=0;
 	long sr;
   ADC0_ISC_R = 0x08;          // acknowledge ADC sequence 3 completion
+	if(DMABufA != NULL){        // the uDMA finished a block
+		UDMA_CHIS_R = DMACHBIT;   // acknowledge it before the buffers change
+		DMA_Handler();
+		return;
+	}
 	sr = StartCritical();
- (*ADC_Task)(ADC0_SSFIFO3_R);
+	DecimateSum += ADC0_SSFIFO3_R&0xFFF;
+	DecimateCount++;
+	Session.Busy = 0;
+	Session_Apply();            // sample boundary, the sequencer is idle
+	if(DecimateCount < Decimation)
+	{
+		EndCritical(sr);
+		return;                    // more samples go into this output
+	}
+ (*ADC_Task)((DecimateSum+Decimation/2)/Decimation);
+	DecimateSum = 0;
+	DecimateCount = 0;
 	if(NumSamples >= RUNLENGTH)
 	{
 		Status=1;							//ADC conversion complete
-		ADC0_IM_R &= ~0x08;             // disable SS3 interrupts when buffer is full
+		Session_Stop();             // no more samples, the session is closed
 	}
 	else
 	{
@@ -271,6 +672,54 @@ int ADC_Status(void){
 	return Status;
 }
 
+//------------ADC_Averaging------------
+// hardware oversampling on ADC0, every sample from ADC_In, ADC_Collect and
+// ADC_CollectDMA becomes the mean of factor back to back conversions, so
+// the noise drops by sqrt(factor) with no extra CPU time, but the
+// conversion rate limit of 125 kHz is shared, fs*factor must stay under it
+// Input: 1 (off), 2, 4, 8, 16, 32 or 64
+// Output: 1 if successful, 0 if factor is not one of these
+int ADC_Averaging(uint32_t factor){
+  volatile uint32_t delay;
+  uint32_t avg = ADC_SAC_AVG_OFF;
+  int32_t sr;
+  if((factor == 0) || (factor > 64)){
+    return 0;
+  }
+  while((1u<<avg) < factor){
+    avg++;
+  }
+  if((1u<<avg) != factor){
+    return 0;
+  }
+  sr = StartCritical();
+  SYSCTL_RCGCADC_R |= 0x01;     // activate ADC0
+  delay = SYSCTL_RCGCADC_R;
+  delay = SYSCTL_RCGCADC_R;
+  ADC0_SAC_R = avg;             // the next conversion uses the new factor
+  EndCritical(sr);
+  return 1;
+}
+
+//------------ADC_Decimation------------
+// software decimation of ADC_Collect, its task gets the rounded mean of
+// every factor samples, fs/factor times a second, on top of any hardware
+// averaging, the new factor starts with the next output
+// Input: 1 (every sample) to 256
+// Output: 1 if successful, 0 if factor is out of range
+int ADC_Decimation(uint32_t factor){
+  int32_t sr;
+  if((factor == 0) || (factor > 256)){
+    return 0;
+  }
+  sr = StartCritical();
+  Decimation = factor;
+  DecimateSum = 0;
+  DecimateCount = 0;
+  EndCritical(sr);
+  return 1;
+}
+
 // This initialization function sets up the ADC according to the
 // following parameters.  Any parameters not explicitly listed
 // below are not modified:
@@ -282,106 +731,14 @@ int ADC_Status(void){
 // SS0 triggering event: software trigger
 // SS0 1st sample source: programmable using variable 'channelNum' [0:11]
 // SS0 interrupts: enabled but not promoted to controller
+void (*volatile InDone)(uint16_t);  // ADC_InAsync callback, NULL when idle
 void ADC_Open(uint32_t channelNum){ 
 	volatile uint32_t delay;
 	long sr;
 	sr = StartCritical();
-  switch(channelNum){             // 1) activate clock
-    case 0:
-    case 1:
-    case 2:
-    case 3:
-    case 8:
-    case 9:                       //    these are on GPIO_PORTE
-      SYSCTL_RCGCGPIO_R |= SYSCTL_RCGCGPIO_R4; break;
-    case 4:
-    case 5:
-    case 6:
-    case 7:                       //    these are on GPIO_PORTD
-      SYSCTL_RCGCGPIO_R |= SYSCTL_RCGCGPIO_R3; break;
-    case 10:
-    case 11:                      //    these are on GPIO_PORTB
-      SYSCTL_RCGCGPIO_R |= SYSCTL_RCGCGPIO_R1; break;
-    default: return;              //    0 to 11 are valid channels on the LM4F120
-  }
-  delay = SYSCTL_RCGCGPIO_R;      // 2) allow time for clock to stabilize
-  delay = SYSCTL_RCGCGPIO_R;
-	delay = SYSCTL_RCGCGPIO_R;
-	delay = SYSCTL_RCGCGPIO_R;
-	delay = SYSCTL_RCGCGPIO_R;
-  switch(channelNum){
-    case 0:                       //      Ain0 is on PE3
-      GPIO_PORTE_DIR_R &= ~0x08;  // 3.0) make PE3 input
-      GPIO_PORTE_AFSEL_R |= 0x08; // 4.0) enable alternate function on PE3
-      GPIO_PORTE_DEN_R &= ~0x08;  // 5.0) disable digital I/O on PE3
-      GPIO_PORTE_AMSEL_R |= 0x08; // 6.0) enable analog functionality on PE3
-      break;
-    case 1:                       //      Ain1 is on PE2
-      GPIO_PORTE_DIR_R &= ~0x04;  // 3.1) make PE2 input
-      GPIO_PORTE_AFSEL_R |= 0x04; // 4.1) enable alternate function on PE2
-      GPIO_PORTE_DEN_R &= ~0x04;  // 5.1) disable digital I/O on PE2
-      GPIO_PORTE_AMSEL_R |= 0x04; // 6.1) enable analog functionality on PE2
-      break;
-    case 2:                       //      Ain2 is on PE1
-      GPIO_PORTE_DIR_R &= ~0x02;  // 3.2) make PE1 input
-      GPIO_PORTE_AFSEL_R |= 0x02; // 4.2) enable alternate function on PE1
-      GPIO_PORTE_DEN_R &= ~0x02;  // 5.2) disable digital I/O on PE1
-      GPIO_PORTE_AMSEL_R |= 0x02; // 6.2) enable analog functionality on PE1
-      break;
-    case 3:                       //      Ain3 is on PE0
-      GPIO_PORTE_DIR_R &= ~0x01;  // 3.3) make PE0 input
-      GPIO_PORTE_AFSEL_R |= 0x01; // 4.3) enable alternate function on PE0
-      GPIO_PORTE_DEN_R &= ~0x01;  // 5.3) disable digital I/O on PE0
-      GPIO_PORTE_AMSEL_R |= 0x01; // 6.3) enable analog functionality on PE0
-      break;
-    case 4:                       //      Ain4 is on PD3
-      GPIO_PORTD_DIR_R &= ~0x08;  // 3.4) make PD3 input
-      GPIO_PORTD_AFSEL_R |= 0x08; // 4.4) enable alternate function on PD3
-      GPIO_PORTD_DEN_R &= ~0x08;  // 5.4) disable digital I/O on PD3
-      GPIO_PORTD_AMSEL_R |= 0x08; // 6.4) enable analog functionality on PD3
-      break;
-    case 5:                       //      Ain5 is on PD2
-      GPIO_PORTD_DIR_R &= ~0x04;  // 3.5) make PD2 input
-      GPIO_PORTD_AFSEL_R |= 0x04; // 4.5) enable alternate function on PD2
-      GPIO_PORTD_DEN_R &= ~0x04;  // 5.5) disable digital I/O on PD2
-      GPIO_PORTD_AMSEL_R |= 0x04; // 6.5) enable analog functionality on PD2
-      break;
-    case 6:                       //      Ain6 is on PD1
-      GPIO_PORTD_DIR_R &= ~0x02;  // 3.6) make PD1 input
-      GPIO_PORTD_AFSEL_R |= 0x02; // 4.6) enable alternate function on PD1
-      GPIO_PORTD_DEN_R &= ~0x02;  // 5.6) disable digital I/O on PD1
-      GPIO_PORTD_AMSEL_R |= 0x02; // 6.6) enable analog functionality on PD1
-      break;
-    case 7:                       //      Ain7 is on PD0
-      GPIO_PORTD_DIR_R &= ~0x01;  // 3.7) make PD0 input
-      GPIO_PORTD_AFSEL_R |= 0x01; // 4.7) enable alternate function on PD0
-      GPIO_PORTD_DEN_R &= ~0x01;  // 5.7) disable digital I/O on PD0
-      GPIO_PORTD_AMSEL_R |= 0x01; // 6.7) enable analog functionality on PD0
-      break;
-    case 8:                       //      Ain8 is on PE5
-      GPIO_PORTE_DIR_R &= ~0x20;  // 3.8) make PE5 input
-      GPIO_PORTE_AFSEL_R |= 0x20; // 4.8) enable alternate function on PE5
-      GPIO_PORTE_DEN_R &= ~0x20;  // 5.8) disable digital I/O on PE5
-      GPIO_PORTE_AMSEL_R |= 0x20; // 6.8) enable analog functionality on PE5
-      break;
-    case 9:                       //      Ain9 is on PE4
-      GPIO_PORTE_DIR_R &= ~0x10;  // 3.9) make PE4 input
-      GPIO_PORTE_AFSEL_R |= 0x10; // 4.9) enable alternate function on PE4
-      GPIO_PORTE_DEN_R &= ~0x10;  // 5.9) disable digital I/O on PE4
-      GPIO_PORTE_AMSEL_R |= 0x10; // 6.9) enable analog functionality on PE4
-      break;
-    case 10:                      //       Ain10 is on PB4
-      GPIO_PORTB_DIR_R &= ~0x10;  // 3.10) make PB4 input
-      GPIO_PORTB_AFSEL_R |= 0x10; // 4.10) enable alternate function on PB4
-      GPIO_PORTB_DEN_R &= ~0x10;  // 5.10) disable digital I/O on PB4
-      GPIO_PORTB_AMSEL_R |= 0x10; // 6.10) enable analog functionality on PB4
-      break;
-    case 11:                      //       Ain11 is on PB5
-      GPIO_PORTB_DIR_R &= ~0x20;  // 3.11) make PB5 input
-      GPIO_PORTB_AFSEL_R |= 0x20; // 4.11) enable alternate function on PB5
-      GPIO_PORTB_DEN_R &= ~0x20;  // 5.11) disable digital I/O on PB5
-      GPIO_PORTB_AMSEL_R |= 0x20; // 6.11) enable analog functionality on PB5
-      break;
+  if(!ADC_PinInit(channelNum)){
+    EndCritical(sr);
+    return;
   }
   SYSCTL_RCGCADC_R |= 0x01;     // activate ADC0  
 
@@ -399,22 +756,173 @@ void ADC_Open(uint32_t channelNum){
   ADC0_SSMUX0_R &= ~0x000F;       // 13) clear SS3 field
   ADC0_SSMUX0_R += channelNum;    //     set channel
   ADC0_SSCTL0_R = 0x0006;         // 14) no TS0 D0, yes IE0 END0
-  ADC0_IM_R &= ~0x0001;           // 15) disable SS0 interrupts
+  ADC0_IM_R &= ~0x0001;           // 15) disable SS0 interrupts, ADC_InAsync turns them on
   ADC0_ACTSS_R |= 0x0001;         // 16) enable sample sequencer 0
+  InDone = NULL;
+  NVIC_PRI3_R = (NVIC_PRI3_R&0xFF00FFFF)|0x00200000; // priority 1
+  NVIC_EN0_R = 1<<14;             // enable interrupt 14 in NVIC
 	EndCritical(sr);
 }
 
 
 
+// ADC_In result, InDone is what keeps SS0 to one conversion at a time
+volatile uint16_t InResult;
+volatile uint32_t InReady;
+static void In_Done(uint16_t result){
+  InResult = result;
+  InReady = 1;
+}
+
 //------------ADC_In------------
-// Busy-wait Analog to digital conversion
+// Busy-wait Analog to digital conversion, it goes through ADC_InAsync so
+// it waits for a conversion some task already started instead of taking
+// its sample, and a periodic ADC_InAsync in the meantime is turned away
 // Input: none
 // Output: 12-bit result of ADC conversion
+// needs interrupts enabled and must not run in an interrupt of priority
+// 0 or 1, the ADC0 SS0 interrupt delivers the result
 uint16_t ADC_In(void){  
-	uint32_t result;
-  ADC0_PSSI_R = 0x0001;            // 1) initiate SS0
-  while((ADC0_RIS_R&0x01)==0){};   // 2) wait for conversion done
-    // if you have an A0-A3 revision number, you need to add an 8 usec wait here
-  result = ADC0_SSFIFO0_R&0xFFF;   // 3) read result
-  return result;
+  InReady = 0;
+  while(!ADC_InAsync(&In_Done)){}; // 1) wait out a pending conversion, initiate SS0
+  while(InReady == 0){};           // 2) wait for conversion done
+  return InResult;                 // 3) read result
+}
+
+//------------ADC_InAsync------------
+// start one conversion on the channel from ADC_Open and return, the
+// result goes to done from the ADC0 SS0 interrupt, priority 1, about 1 us
+// later, so a periodic task does not spin while the ADC converts
+// it returns 0 while an ADC_In is converting as well
+// Input: function to call with the 12-bit result
+// Output: 1 if started, 0 if the previous conversion has not finished
+int ADC_InAsync(void(*done)(uint16_t result)){
+  int32_t sr;
+  sr = StartCritical();
+  if(InDone != NULL){
+    EndCritical(sr);
+    return 0;
+  }
+  InDone = done;
+  ADC0_ISC_R = 0x0001;
+  ADC0_IM_R |= 0x0001;             // interrupt when this one is done
+  ADC0_PSSI_R = 0x0001;            // initiate SS0
+  EndCritical(sr);
+  return 1;
+}
+
+void ADC0Seq0_Handler(void){
+  void (*done)(uint16_t) = InDone;
+  uint16_t result;
+  ADC0_IM_R &= ~0x0001;            // until the next ADC_InAsync
+  result = ADC0_SSFIFO0_R&0xFFF;
+  ADC0_ISC_R = 0x0001;             // acknowledge ADC sequence 0 completion, clears RIS
+  InDone = NULL;                   // done may start the next one
+  if(done != NULL){
+    (*done)(result);
+  }
+}
+
+// multi-channel scan on ADC1 sample sequencer 0, which holds up to 8
+// conversions, so the whole scan is one trigger and one interrupt
+// WideTimer0A (timer 12 in TIMER.c) triggers it, the ADC timer trigger is
+// shared by every timer with its trigger output on, so it should not run
+// together with ADC_Collect unless both rates are wanted on both
+#define SCANTIMER 12          // WideTimer0A in TIMER.c numbering
+void (*ADC_ScanTask)(const uint16_t samples[], uint32_t n);
+uint16_t ScanSamples[ADC_SCANMAX];
+uint32_t ScanTimer;           // 1 while the scan holds WideTimer0A
+
+//------------ADC_ScanStart------------
+// sample a list of channels back to back at every trigger, fs times a second
+// Input: channels 0 to 11 in the order they are sampled, n of them, 1 to 8
+//        sampling rate in Hz, n*fs up to 125 kHz
+//        task to call with the n samples of each scan, in list order
+// Output: 1 if successful, 0 if a channel, n or fs is out of range or
+//         WideTimer0 is in use by a periodic thread
+// task runs in the ADC1 sequencer 0 interrupt, priority 2
+int ADC_ScanStart(const uint8_t channels[], uint32_t n, uint32_t fs,
+  void(*task)(const uint16_t samples[], uint32_t n)){
+  volatile uint32_t delay;
+  uint32_t mux = 0;
+  uint32_t i;
+  uint32_t period;
+  int32_t sr;
+  if((n == 0) || (n > ADC_SCANMAX) || (fs == 0) || (fs > 125000/n)){
+    return 0;                   // n conversions per scan share the 125 ksps
+  }
+  period = Session_Period(fs, NULL);
+  if(period == 0){
+    return 0;
+  }
+  for(i=0; i<n; i++){
+    if(!ADC_PinInit(channels[i])){
+      return 0;
+    }
+    mux |= channels[i]<<(4*i);
+  }
+  sr = StartCritical();
+  SYSCTL_RCGCADC_R |= 0x02;     // activate ADC1
+  SYSCTL_RCGCWTIMER_R |= 0x01;  // activate wide timer0
+  delay = SYSCTL_RCGCWTIMER_R;  // allow time to finish activating
+  delay = SYSCTL_RCGCADC_R;
+  if(!ScanTimer){
+    if(TIMER_Reserve(SCANTIMER) < 0){ // not free for periodic threads now
+      EndCritical(sr);
+      return 0;
+    }
+    ScanTimer = 1;
+  }
+  WTIMER0_CTL_R = 0;            // disable during setup
+  WTIMER0_CFG_R = 0;            // one 64-bit timer
+  WTIMER0_TAMR_R = TIMER_TAMR_TAMR_PERIOD;
+  WTIMER0_TAILR_R = period-1;
+  WTIMER0_TBILR_R = 0;          // upper 32 bits
+  WTIMER0_IMR_R = 0;            // no timer interrupts, only the ADC trigger
+  WTIMER0_CTL_R = TIMER_CTL_TAOTE|TIMER_CTL_TAEN;
+  ADC1_PC_R = ADC_PC_SR_125K;   // 125K samples/sec
+  ADC1_SSPRI_R = 0x3210;        // sequencer 0 is highest
+  ADC1_ACTSS_R &= ~0x01;        // disable sample sequencer 0
+  ADC1_EMUX_R = (ADC1_EMUX_R&~0x000F)+0x0005; // timer trigger event
+  ADC1_SSMUX0_R = mux;
+  ADC1_SSCTL0_R = 0x06<<(4*(n-1)); // interrupt and end after the last one
+  while((ADC1_SSFSTAT0_R&ADC_SSFSTAT0_EMPTY) == 0){
+    delay = ADC1_SSFIFO0_R;     // drop anything left from before
+  }
+  ADC_ScanTask = task;
+  ADC1_ISC_R = 0x01;
+  ADC1_IM_R |= 0x01;            // enable SS0 interrupts
+  ADC1_ACTSS_R |= 0x01;         // enable sample sequencer 0
+  NVIC_PRI12_R = (NVIC_PRI12_R&0xFFFFFF00)|0x00000040; // priority 2
+  NVIC_EN1_R = 1<<(48-32);      // enable interrupt 48 in NVIC
+  EndCritical(sr);
+  return 1;
+}
+
+//------------ADC_ScanStop------------
+// stop the scan started by ADC_ScanStart
+// Input: none
+// Output: none
+void ADC_ScanStop(void){
+  int32_t sr = StartCritical();
+  WTIMER0_CTL_R = 0;
+  ADC1_IM_R &= ~0x01;
+  ADC1_ACTSS_R &= ~0x01;
+  NVIC_DIS1_R = 1<<(48-32);
+  if(ScanTimer){
+    TIMER_TimerFree(SCANTIMER);
+    ScanTimer = 0;
+  }
+  EndCritical(sr);
+}
+
+// one interrupt per scan, all of its samples are in the sequencer FIFO
+void ADC1Seq0_Handler(void){
+  uint32_t n = 0;
+  ADC1_ISC_R = 0x01;            // acknowledge ADC1 sequence 0 completion
+  while(((ADC1_SSFSTAT0_R&ADC_SSFSTAT0_EMPTY) == 0) && (n < ADC_SCANMAX)){
+    ScanSamples[n] = ADC1_SSFIFO0_R&0xFFF;
+    n++;
+  }
+  (*ADC_ScanTask)(ScanSamples, n);
 }
@@ -1,12 +1,79 @@
 //Software-triggered one sample initialization
 
+#include <stdint.h>
 
+void ADC_Open(uint32_t channelNum);
 
-int ADC_Open(unsigned int channelNum);
+// one conversion on the ADC_Open channel, busy-waits for the result
+// needs interrupts enabled, it shares SS0 with ADC_InAsync
+uint16_t ADC_In(void);
 
-unsigned short ADC_In(void);
+// starts one conversion on the ADC_Open channel and returns at once, done
+// gets the result from the ADC interrupt when it finishes
+// returns 1 if started, 0 if the last one is still converting
+int ADC_InAsync(void(*done)(uint16_t result));
 
 //Timer-triggered
 //int ADC_Collect(unsigned int channelNum, unsigned int fs,unsigned short buffer[], unsigned int numberOfSamples); 
 void ADC_Collect(uint8_t channelNum, uint32_t fs, void(*task)(unsigned long));
+
+// sampling session of ADC0 sequencer 3, changes take effect at a sample
+// boundary without setting the ADC up again
+#define ADC_TRIGGER_SOFTWARE 0x0  // ADC_SessionSample starts each sample
+#define ADC_TRIGGER_TIMER    0x5  // Timer0A at the session rate
+
+// starts sampling channelNum at fs Hz with task, or changes an open session
+// achieved gets the exact rate in 0.001 Hz units from the bus clock, or NULL
+// returns 1 if successful, 0 if the channel or rate is out of range or
+// a periodic thread has Timer0
+int ADC_SessionOpen(uint8_t channelNum, uint32_t fs, void(*task)(unsigned long),
+  unsigned long *achieved);
+
+// the calls below return 0 once the session has stopped sampling
+
+// changes the rate after the current period, returns 1 if successful
+int ADC_SessionRate(uint32_t fs, unsigned long *achieved);
+
+// changes the channel from the next sample, returns 1 if successful
+int ADC_SessionChannel(uint8_t channelNum);
+
+// ADC_TRIGGER_TIMER or ADC_TRIGGER_SOFTWARE, returns 1 if successful
+int ADC_SessionTrigger(uint32_t trigger);
+
+// one sample under ADC_TRIGGER_SOFTWARE, returns 1 if started
+int ADC_SessionSample(void);
 int ADC_Status(void);
+
+// hardware averaging of 1 (off), 2, 4, ... 64 conversions per ADC0 sample,
+// fs times factor must stay under 125 kHz
+// returns 1 if successful, 0 if factor is not a power of 2 up to 64
+int ADC_Averaging(uint32_t factor);
+
+// ADC_Collect passes the mean of every factor samples to its task, 1 to 256
+// returns 1 if successful, 0 if factor is out of range
+int ADC_Decimation(uint32_t factor);
+
+// samples one channel fs times a second into bufA and bufB in turn with the
+// uDMA, n samples each, n up to 1024, and calls task with each full buffer
+// from the ADC interrupt while the other one fills
+// returns 1 if successful, 0 if the channel or n is out of range or
+// a periodic thread has Timer0
+int ADC_CollectDMA(uint8_t channelNum, uint32_t fs, uint16_t bufA[], uint16_t bufB[],
+  uint32_t n, void(*task)(uint16_t buffer[], uint32_t n));
+
+// stops ADC_CollectDMA sampling
+void ADC_CollectDMAStop(void);
+
+//Timer-triggered multi-channel scan on ADC1, one interrupt per scan
+#define ADC_SCANMAX 8   // channels in one scan, the depth of sequencer 0
+
+// samples up to 8 channels back to back fs times a second and calls task
+// with the samples of each scan, in list order, from the ADC interrupt
+// n*fs is at most 125 kHz, the conversion rate of ADC1
+// returns 1 if successful, 0 if a channel, n or fs is out of range or
+// a periodic thread has WideTimer0
+int ADC_ScanStart(const uint8_t channels[], uint32_t n, uint32_t fs,
+  void(*task)(const uint16_t samples[], uint32_t n));
+
+// stops the scan started by ADC_ScanStart
+void ADC_ScanStop(void);
@@ -131,10 +131,17 @@ void Interpreter(void){
 	printf("ADC_In\n\r");
 	printf("ADC_Collect\n\r");
 	printf("ADC_Status\n\r");
+	printf("ADC_Avg - hardware averaging and ADC_Collect decimation\n\r");
+	printf("ADC_Rate - change the ADC_Collect rate and channel while it runs\n\r");
 	printf("OS-RTP - OS_ReadTimerPeriod\n\r");
 	printf("OS-RTV - OS_ReadTimerValue\n\r");
 	printf("OS-CPT - OS_ClearPeriodicTime\n\r");
 	printf("OS-ST - OS_StopThread\n\r");
+	printf("stack - peak stack use of each thread\n\r");
+	printf("jitter - latency and run time of each timer task\n\r");
+	printf("trace - binary dump of the scheduler trace for trace_decode.py\n\r");
+	printf("top - CPU use of each thread and timer task\n\r");
+	printf("edf - deadline misses of each EDF thread\n\r");
 	
 	while(1){
 		//PE4^=0x10;
@@ -189,6 +196,85 @@ void Interpreter(void){
 				}
 			}
 		} 
+		
+		else if(!strcmp(input_str,"ADC_Avg")){
+			printf("\n\rHardware averaging (1-64): ");
+			input_num=UART_InUDec();
+			if(!ADC_Averaging(input_num)){
+				printf("\n\rMust be 1, 2, 4, 8, 16, 32 or 64");
+			}
+			printf("\n\rDecimation (1-256): ");
+			input_num=UART_InUDec();
+			if(!ADC_Decimation(input_num)){
+				printf("\n\rOut of range");
+			}
+		}
+		
+		else if(!strcmp(input_str,"ADC_Rate")){
+			unsigned long achieved;
+			printf("\n\rSampling Frequency: ");
+			freq=UART_InUDec();
+			printf("\n\rChannel: ");
+			input_num=UART_InUDec();
+			if(!ADC_SessionRate(freq,&achieved) || !ADC_SessionChannel(input_num)){
+				printf("\n\rNo ADC_Collect running or out of range");
+			}else{
+				printf("\n\rAchieved: %lu.%03lu Hz",achieved/1000,achieved%1000);
+			}
+		}
+		
+		else if(!strcmp(input_str,"stack")){
+			unsigned long slot,id,size,peak,overflow;
+			int used;
+			printf("\n\rID  Size  Peak");
+			for(slot=0;(used=OS_StackInfo(slot,&id,&size,&peak,&overflow))>=0;slot++){
+				if(used){
+					printf("\n\r%-3lu %-5lu %-5lu%s",id,size,peak,overflow?" OVERFLOW":"");
+				}
+			}
+		}
+		
+		else if(!strcmp(input_str,"jitter")){
+			Jitter();
+		}
+		
+		else if(!strcmp(input_str,"trace")){
+			OS_TraceDump();
+		}
+		
+		else if(!strcmp(input_str,"edf")){
+			unsigned long slot,id,period,deadline,jobs,misses;
+			int used;
+			printf("\n\rID       period deadline     jobs   misses");
+			for(slot=0;(used=OS_EDFInfo(slot,&id,&period,&deadline,&jobs,&misses))>=0;slot++){
+				if(used){
+					printf("\n\r%-8lu%6lu %8lu %8lu %8lu",id,period,deadline,jobs,misses);
+				}
+			}
+		}
+		
+		else if(!strcmp(input_str,"top")){
+			unsigned long slot,id,percent;
+			unsigned long long total;
+			int used;
+			printf("\n\rID       CPU%%     total ms");
+			for(slot=0;(used=OS_CpuInfo(slot,&id,&percent,&total))>=0;slot++){
+				if(used){
+					printf("\n\r%-8lu%3lu.%lu %12lu",id,percent/10,percent%10,(unsigned long)(total/TIME_1MS));
+				}
+			}
+			printf(" (idle)");
+			for(slot=0;(used=OS_IsrCpuInfo(slot,&percent,&total))>=0;slot++){
+				if(used){
+					if(slot==OS_SYSTICKTASK){
+						printf("\n\rSysTick ");
+					}else{
+						printf("\n\rtimer %-2lu",slot);
+					}
+					printf("%3lu.%lu %12lu",percent/10,percent%10,(unsigned long)(total/TIME_1MS));
+				}
+			}
+		}
 	/*	
 		else if(!strcmp(input_str,"OS-RTP")){
 			printf("\n\rTimer to Read:");
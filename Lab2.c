@@ -33,7 +33,7 @@
 
 extern void Interpreter(void);
 extern int g_NumAliveThreads;
-extern void Jitter(void);   // prints jitter information (write this)
+extern void Jitter(void);   // prints jitter information
 
 int32_t StartCritical(void);
 void EndCritical(int32_t primask);
@@ -53,6 +53,7 @@ unsigned long NumSamples;   // incremented every ADC sample, in Producer
 // 20-sec finite time experiment duration 
 
 #define PERIOD TIME_500US // DAS 2kHz sampling period in system time units
+#define DASTIMER 4        // Timer2A, the OS keeps its jitter statistics
 //#define PERIOD 800000   //100 Hz
 //#define PERIOD 160000   // 500 Hz
 //#define PERIOD 80000    //1000 Hz
@@ -60,10 +61,6 @@ long x[64],y[64];         // input and output arrays for FFT
 
 //---------------------User debugging-----------------------
 unsigned long DataLost;     // data sent by Producer, but not received by Consumer
-long MaxJitter;             // largest time jitter between interrupts in usec
-#define JITTERSIZE 64
-unsigned long const JitterSize=JITTERSIZE;
-unsigned long JitterHistogram[JITTERSIZE]={0,};
 #define PE0  (*((volatile unsigned long *)0x40024004))
 #define PE1  (*((volatile unsigned long *)0x40024008))
 #define PE2  (*((volatile unsigned long *)0x40024010))
@@ -104,45 +101,31 @@ long Filter(long data)
   return y[n];
 } 
 //******** DAS *************** 
-// background thread, calculates 60Hz notch filter
+// background thread, starts a conversion and returns, DASDone gets
+// the sample from the ADC interrupt and calculates 60Hz notch filter
 // runs 2000 times/sec
 // samples channel 4, PD3,
+// its jitter is measured by the OS, see Jitter()
 // inputs:  none
 // outputs: none
 unsigned long DASoutput;
+unsigned long DASMissed;    // DAS found the previous conversion still pending
+void DASDone(uint16_t input)
+{ 
+  PE0 ^= 0x01;
+  DASoutput = Filter(input);
+  FilterWork++;        // calculation finished
+  PE0 ^= 0x01;
+}
 void DAS(void)
 { 
-	unsigned long input;  
-	unsigned static long LastTime;  // time at previous ADC sample
-	unsigned long thisTime;         // time at current ADC sample
-	long jitter;                    // time between measured and expected, in us
-  
 	if(NumSamples < RUNLENGTH)
 	{   // finite time run
-		int i;
     PE0 ^= 0x01;
-    input = ADC_In();           // channel set when calling ADC_Init
-    PE0 ^= 0x01;
-    thisTime = OS_Time();       // current time, 12.5 ns
-		//for(i=0;i<=500;i++){}
-    DASoutput = Filter(input);
-    FilterWork++;        // calculation finished
-    if(FilterWork > 1)
-		{    // ignore timing of first interrupt
-      unsigned long diff = OS_TimeDifference(LastTime,thisTime);
-			jitter = (diff > PERIOD) ? (diff-PERIOD+4)/8:(PERIOD-diff+4)/8; // in 0.1 usec
-			
-      if(jitter > MaxJitter)
-			{
-        MaxJitter = jitter; // in usec
-      }       // jitter should be 0
-      if(jitter >= JitterSize)
-			{
-        jitter = JITTERSIZE-1;
-      }
-      JitterHistogram[jitter]++; 
+    if(!ADC_InAsync(&DASDone))  // channel set when calling ADC_Open
+		{
+      DASMissed++;
     }
-    LastTime = thisTime;
     PE0 ^= 0x01;
   }
 }
@@ -157,13 +140,16 @@ void DAS(void)
 void ButtonWork(void)
 {
 	unsigned long myId = OS_Id(); 
+	OSTaskProfileType das;
   PE1 ^= 0x02;
   ST7735_Message(1,8,"NumCreated =",g_NumAliveThreads); 
   PE1 ^= 0x02;
   OS_Sleep(50);     // set this to sleep for 50msec
   ST7735_Message(1,9,"PIDWork     =",PIDWork);
   ST7735_Message(1,10,"DataLost    =",DataLost);
-  ST7735_Message(1,11,"Jitter 0.1us=",MaxJitter);
+  if(OS_TaskProfile(DASTIMER,&das) > 0){ // spread of the DAS interrupt latency
+    ST7735_Message(1,11,"Jitter 0.1us=",(das.LatencyMax-das.LatencyMin+4)/8);
+  }
   PE1 ^= 0x02;
   OS_Kill();  // done, OS does not return from a Kill
 } 
@@ -204,7 +190,7 @@ void SW2Push(void){
 // Producer runs as part of ADC ISR
 // Producer uses fifo to transmit 400 samples/sec to Consumer
 // every 64 samples, Consumer calculates FFT
-// every 2.5ms*64 = 160 ms (6.25 Hz), consumer sends data to Display via mailbox
+// every 2.5ms*64 = 160 ms (6.25 Hz), consumer sends data to Display via a message queue
 // Display thread updates LCD with measurement
 
 //******** Producer *************** 
@@ -228,6 +214,10 @@ void Producer(unsigned long data)
   } 
 }
 void Display(void); 
+#define DISPLAYDEPTH 4
+unsigned long DisplayBuf[DISPLAYDEPTH];
+OSQueueType DisplayQueue;   // Consumer to Display, so the FFT does not wait for the LCD
+unsigned long DisplayLost;  // results the LCD was too slow for
 
 //******** Consumer *************** 
 // foreground thread, accepts data from producer
@@ -236,23 +226,21 @@ void Display(void);
 // outputs: none
 void Consumer(void)
 { 
-	unsigned long data,DCcomponent;   // 12-bit raw ADC sample, 0 to 4095
-	unsigned long t;                  // time in 2.5 ms
+	unsigned long DCcomponent;
 	unsigned long myId = OS_Id(); 
   ADC_Collect(4, FS, &Producer); // start ADC sampling, channel 4, PD3, 400 Hz                /********Change ADC_Collect*****/
   NumCreated += OS_AddThread(&Display,128,0); 
   while(NumSamples < RUNLENGTH) 
 	{ 
     PE2 = 0x04;
-    for(t = 0; t < 64; t++)
-		{   // collect 64 ADC samples
-      data = OS_Fifo_Get();    // get from producer
-      x[t] = data;             // real part is 0 to 4095, imaginary part is 0
-    }
+    OS_Fifo_GetBlock((unsigned long *)x, 64); // collect 64 ADC samples, real part is 0 to 4095, imaginary part is 0
     PE2 = 0x00;
     cr4_fft_64_stm32(y,x,64);  // complex FFT of last 64 ADC values
     DCcomponent = y[0]&0xFFFF; // Real part at frequency 0, imaginary part should be zero
-    OS_MailBox_Send(DCcomponent); // called every 2.5ms*64 = 160ms
+    if(OS_QueueTrySend(&DisplayQueue, &DCcomponent) == 0)
+		{ // called every 2.5ms*64 = 160ms, never waits behind the LCD
+      DisplayLost++;
+    }
   }
   OS_Kill();  // done
 }
@@ -266,7 +254,10 @@ unsigned long data,voltage;
   ST7735_Message(0,0,"Run length = ",(RUNLENGTH)/FS);   // top half used for Display
   while(NumSamples < RUNLENGTH) 
 	{ 
-    data = OS_MailBox_Recv();
+    if(OS_QueueRecvTimeout(&DisplayQueue, &data, 1000) == 0)
+		{ // nothing for a second, check whether the run is over
+      continue;
+    }
     voltage = 3000*data/4095;               // calibrate your device so voltage is in mV
     PE3 = 0x08;
     ST7735_Message(0,1,"v(mV) =",voltage);  
@@ -345,15 +336,16 @@ int Testmain_final(void)
 { 
   OS_Init();           // initialize, disable interrupts
   PortE_Init();
-	OS_InitSemaphore(&LCDmutex,1);
+	OS_MutexInit(&LCDmutex);
 	Output_Init();
   DataLost = 0;        // lost data between producer and consumer
   NumSamples = 0;
-  MaxJitter = 0;       // in 1us units
+  OS_ProfileReset();   // jitter statistics
 
 
 //********initialize communication channel
   OS_MailBox_Init();
+  OS_QueueInit(&DisplayQueue, DisplayBuf, sizeof(DisplayBuf[0]), DISPLAYDEPTH);
   OS_Fifo_Init(128);    // ***note*** 4 is not big enough*****
 
 //*******attach background tasks***********
@@ -364,10 +356,10 @@ int Testmain_final(void)
   NumCreated = 0 ;
 // create initial foreground threads
   NumCreated += OS_AddThread(&Interpreter,128,2); 
-  NumCreated += OS_AddThread(&Consumer,128,1); 
+  NumCreated += OS_AddThread(&Consumer,512,1); // FFT needs the bigger stack
   NumCreated += OS_AddThread(&PID,128,3);  // Lab 3, make this lowest priority
 	ADC_Open(10);  // sequencer 3, channel 10, PB4, sampling in DAS()											/*****Change ADC_Init********/
-	OS_AddPeriodicThread(&DAS,4,2000,0); // 2 kHz real time sampling of PB4, Timer2
+	OS_AddPeriodicThread(&DAS,DASTIMER,PERIOD,0); // 2 kHz real time sampling of PB4, Timer2
  
   OS_Launch(TIME_2MS); // doesn't return, interrupts enabled in here
   return 0;            // this never executes
@@ -558,7 +550,7 @@ void Thread2c(void)
   Count2 = 0;    
   Count5 = 0;    // Count2 + Count5 should equal Count1  
   NumCreated += OS_AddThread(&Thread5c,128,3); 
-  OS_AddPeriodicThread(&BackgroundThread1c,4,1000,0);
+  OS_AddPeriodicThread(&BackgroundThread1c,4,TIME_1MS,0);
   for(;;)
 	{
     OS_Wait(&Readyc);
@@ -685,7 +677,7 @@ int Testmain4(void)
   Count4 = 0;          
   OS_Init();           // initialize, disable interrupts
   NumCreated = 0 ;
-  OS_AddPeriodicThread(&BackgroundThread1d,4,1000,0); //Timer
+  OS_AddPeriodicThread(&BackgroundThread1d,4,TIME_1MS,0); //Timer
 
   OS_AddSwitchTasks(&BackgroundThread5d,&doNothing,2);
 
@@ -763,7 +755,7 @@ int Testmain5(void)
   NumCreated += OS_AddThread(&Thread6,128,2); 
   NumCreated += OS_AddThread(&Thread7,128,1); 
   OS_AddPeriodicThread(&TaskA,1,TIME_1MS,0);           // 1 ms, higher priority
-  OS_AddPeriodicThread(&TaskB,2,2*TIME_1MS,1);         // 2 ms, lower priority
+  OS_AddPeriodicThread(&TaskB,6,2*TIME_1MS,1);         // 2 ms, lower priority
  
   OS_Launch(TIME_2MS); // 2ms, doesn't return, interrupts enabled in here
   return 0;             // this never executes
@@ -872,7 +864,7 @@ int Testmain6(void)
   WaitCount3 = 0;	  // number of times s is successfully waited on
   OS_InitSemaphore(&s,0);	 // this is the test semaphore
   OS_AddPeriodicThread(&Signal1,1,(799*TIME_1MS)/1000,0);   // 0.799 ms, higher priority
-  OS_AddPeriodicThread(&Signal2,2,(1111*TIME_1MS)/1000,1);  // 1.111 ms, lower priority
+  OS_AddPeriodicThread(&Signal2,6,(1111*TIME_1MS)/1000,1);  // 1.111 ms, lower priority
   NumCreated = 0 ;
   NumCreated += OS_AddThread(&Thread6,128,6);    	// idle thread to keep from crashing
   NumCreated += OS_AddThread(&OutputThread,128,2); 	// results output thread
@@ -912,4 +904,92 @@ int Testmain7(void)
   OS_Launch(TIME_1MS/10); // 100us, doesn't return, interrupts enabled in here1111111111111111111111111111111111111111111111111
   return 0;             // this never executes
 }
+
+//******************* SysTick cost vs number of sleeping threads**********
+// Run this with NUMSLEEPERS set to 1, 6 and 12 and watch SysTickTime and
+// MaxSysTickTime (12.5ns units) in the debugger, or PE5 on the logic analyzer
+// the tick only touches the head of the sleep list, so the time should not
+// grow with the number of sleeping threads, only with the number of wakeups
+// UART0 not needed 
+// SYSTICK interrupts, period established by OS_Launch
+// no timer interrupts
+// SW1 not needed, 
+// SW2 not needed
+#define NUMSLEEPERS 6
+extern unsigned long SysTickTime;
+extern unsigned long MaxSysTickTime;
+unsigned long SleeperWakeups;
+void Sleeper(void)
+{       // wakes up every 10 to 21 ms depending on its ID
+  unsigned long sleepTime = 10+(OS_Id()&0xFF); // slot number
+  for(;;)
+	{
+    OS_Sleep(sleepTime);
+    SleeperWakeups++;
+  }
+}
+int Testmain8(void)
+{       // Testmain8
+  int i;
+  PortE_Init();
+  OS_Init();           // initialize, disable interrupts
+  NumCreated = 0 ;
+  for(i = 0; i < NUMSLEEPERS; i++)
+	{
+    NumCreated += OS_AddThread(&Sleeper,128,1); 
+  }
+  OS_Launch(TIME_1MS); // 1ms, doesn't return, interrupts enabled in here
+  return 0;             // this never executes
+}
+
+//******************* uDMA ping-pong ADC streaming**********
+// samples PE2 (channel 1) at 10 kHz into two 256 sample buffers with the uDMA,
+// the ADC interrupt runs once per buffer and signals BlockReady, the consumer
+// thread averages each block while the uDMA fills the other buffer
+// watch BlockCount, BlockMean and BlockOverrun in the debugger
+// UART0 not needed 
+// SYSTICK interrupts, period established by OS_Launch
+// ADC0 SS3 interrupt once per block
+// SW1 not needed, 
+// SW2 not needed
+#define BLOCKSIZE 256
+uint16_t BlockA[BLOCKSIZE], BlockB[BLOCKSIZE];
+uint16_t *volatile FullBlock;
+Sema4Type BlockReady;
+unsigned long BlockCount, BlockMean, BlockOverrun;
+void BlockDone(uint16_t buffer[], uint32_t n)
+{       // ADC interrupt, the other buffer is filling now
+  if(BlockReady.Value > 0)
+	{
+    BlockOverrun++;     // consumer did not keep up
+  }
+  FullBlock = buffer;
+  OS_Signal(&BlockReady);
+}
+void BlockConsumer(void)
+{       // has BLOCKSIZE/10kHz = 25.6 ms for each block
+  int i;
+  unsigned long sum;
+  for(;;)
+	{
+    OS_Wait(&BlockReady);
+    sum = 0;
+    for(i = 0; i < BLOCKSIZE; i++)
+		{
+      sum += FullBlock[i];
+    }
+    BlockMean = sum/BLOCKSIZE;
+    BlockCount++;
+  }
+}
+int Testmain9(void)
+{       // Testmain9
+  OS_Init();           // initialize, disable interrupts
+  OS_InitSemaphore(&BlockReady, 0);
+  NumCreated = 0 ;
+  NumCreated += OS_AddThread(&BlockConsumer,128,1); 
+  ADC_CollectDMA(1, 10000, BlockA, BlockB, BLOCKSIZE, &BlockDone);
+  OS_Launch(TIME_1MS); // 1ms, doesn't return, interrupts enabled in here
+  return 0;             // this never executes
+}
 #endif
@@ -7,8 +7,10 @@
 #include "tm4c123gh6pm.h"
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include "PLL.h"
 #include "TIMER.h"
+#include "UART.h"
 #include "ifdef.h"
 
 // function definitions in osasm.s
@@ -18,6 +20,7 @@ int32_t StartCritical(void);
 void EndCritical(int32_t primask);
 void PendSV_Handler(); // used for context switching in SysTick
 void StartOS(void);
+void WaitForInterrupt(void);  // low power mode, in startup.s
 
 #define MAILBOX_EMPTY	1
 #define MAILBOX_FULL	0
@@ -27,64 +30,600 @@ void StartOS(void);
 
 #define FREE 0
 #define USED 1
+#define ZOMBIE 2   // killed, still running until the next context switch
 
 #define NUMTHREADS 12
-#define STACKSIZE 128
+#define STACKSIZE 128      // words, the average stack the arena is sized for
+#define STACKARENASIZE (NUMTHREADS*STACKSIZE) // words shared by all thread stacks
+#define MINSTACKSIZE 32    // words, room for the initial context and a few calls
+#define USERPRIORITIES 8   // OS_AddThread priorities, 0 is the highest, 7 the lowest
+#define NUMPRIORITIES (USERPRIORITIES+1) // scheduling levels, 0 is the highest, OS_EDFPRIORITY is one of them
+// the level of OS_AddThread priority p, OS_EDFPRIORITY is skipped so only EDF threads are on it
+#define PRIORITYLEVEL(p) (((p) < OS_EDFPRIORITY) ? (p) : ((p)+1))
+#define IDLESTACKSIZE 64
+#define STACKPAINT 0xDEADBEEF // unused stack words hold this, StackBase[0] is the canary
 struct tcb{
-	int32_t *sp;
-	struct tcb *next;
-	struct tcb *previous;
-	int32_t ID;
-	int32_t SleepCtr;
-	int32_t Priority;
+	int32_t *sp;           // saved stack pointer, must be first, used by osasm.s
+	struct tcb *next;      // next thread in the same ready list
+	struct tcb *previous;  // previous thread in the same ready list
+	int32_t ID;            // generation in the upper bits, slot in the low 8 bits
+	uint32_t Generation;   // bumped every time the slot is reused
+	int32_t SleepCtr;      // ms after the previous thread in the sleep list wakes up
+	struct tcb *SleepNext; // sleep list, sorted by wakeup time
+	struct tcb *SleepPrevious;
+	int32_t Priority;      // running level, can be raised by the mutexes it holds
+	int32_t BasePriority;  // level it was added at
+	struct OSMutex *Held;  // mutexes it owns, linked through NextHeld
+	struct OSMutex *WaitMutex; // mutex it is blocked on, NULL if none
+	uint32_t Period;       // ms between EDF releases, 0 for a fixed priority thread
+	uint32_t RelDeadline;  // ms after each release the job has to be done by
+	uint32_t Release;      // g_upTime of the current EDF release
+	uint32_t Deadline;     // g_upTime the current EDF job is due, orders the EDF ready list
+	uint32_t Jobs;         // EDF jobs finished
+	uint32_t Misses;       // EDF jobs finished after their deadline
 	int32_t MemStatus;
+	Sema4Type *BlockPt;    // semaphore this thread is waiting on, NULL if none
+	int32_t TimedOut;      // set when OS_WaitTimeout gave up before a signal came
+	int32_t *StackBase;    // lowest address of its stack in StackArena, kept while free
+	uint32_t StackSize;    // words
+	int32_t StackOverflow; // set once the canary at StackBase was found overwritten
+#ifdef PROFILE
+	unsigned long long RunTime; // bus cycles it has run, not counting timer tasks and SysTick
+	unsigned long long RunLast; // RunTime at the last utilization snapshot
+	uint32_t Percent;      // 0.1% units of the CPU over the last snapshot
+#endif
 };
 typedef struct tcb tcbType;
 tcbType tcbs[NUMTHREADS];
 tcbType *RunPt;
-int32_t Stacks[NUMTHREADS][STACKSIZE];
-int32_t g_sleepingThreads[NUMTHREADS];
-int32_t g_numSleepingThreads = 0;
+tcbType *FreeTcbs; // unused TCBs linked through next, each may still hold its old stack
+#define IDSLOTBITS 8
+#define IDGENERATIONMAX (0xFFFFFFFF>>(IDSLOTBITS+1)) // keeps IDs positive
+
+// thread stacks are carved out of one arena, free blocks are kept in
+// address order so neighbors can be merged back together when freed
+struct freeblock{
+	uint32_t Size;            // words in this block, including this header
+	struct freeblock *Next;   // next free block at a higher address
+};
+typedef struct freeblock freeblockType;
+int64_t StackArena[STACKARENASIZE/2]; // 64-bit elements keep every stack 8-byte aligned
+freeblockType *FreeStacks;
 Sema4Type g_mailboxDataValid, g_mailboxFree;
-Sema4Type g_dataAvailable, g_roomLeft, g_fifoMutex;
 unsigned long g_msTime; // num of ms since SysTick has started counting
+uint32_t g_upTime;       // ms since SysTick started, never cleared, EDF releases and deadlines
+uint32_t g_timeSlice;    // bus cycles per time slice, set by OS_Launch
+uint32_t g_cycleResidue; // bus cycles that have passed but not made up a whole ms yet
+#define SYSTICK_MAX 0x01000000 // longest SysTick period, 24-bit counter
+#ifdef TICKLESS
+uint32_t g_ticklessPeriod; // bus cycles SysTick was set to while idle, 0 while ticking normally
+#endif
+
+// one circular list of ready threads per priority level
+// bit (31-priority) of g_readyBitmap is set while ReadyList[priority] is not empty
+// so the highest ready priority is the number of leading zeros of the bitmap
+tcbType *ReadyList[NUMPRIORITIES];
+uint32_t g_readyBitmap;
+#define PRIORITYBIT(p) (0x80000000>>(p))
+#ifdef __CC_ARM
+#define CLZ(x) __clz(x)              // single CLZ instruction
+#else
+#define CLZ(x) __builtin_clz(x)
+#endif
+
+// sleeping threads sorted by wakeup time, each SleepCtr is relative to the
+// thread in front of it so a tick only has to decrement the head
+tcbType *SleepList;
+
+// system time is Timer1A counting down through all 32 bits, each time it
+// wraps the upper 32 bits of the 64-bit time go up by one
+#define OSTIMER 2          // Timer1A in TIMER.c numbering, not free for periodic threads
+volatile uint32_t g_timeHigh;
+void OS_TimeOverflow(void);
+
+// software timers, a min-heap ordered by expiration time on top of one
+// hardware one-shot timer that is always set for the earliest of them
+#define SWTIMER 10         // Timer5A in TIMER.c numbering, not free for periodic threads
+#define MAXSWTIMERS 32
+#define SWTIMERMIN 80      // bus cycles, shortest one-shot so it is not missed
+OSTimerType *TimerHeap[MAXSWTIMERS];
+uint32_t g_numTimers;
+void static SWTimer_Handler(void);
+
+#ifdef DEBUG
+unsigned long SysTickTime;    // 12.5ns units spent in the last SysTick_Handler
+unsigned long MaxSysTickTime; // worst case SysTick_Handler time
+#endif
+
+// runs when every thread is sleeping or blocked
+tcbType IdleTcb;
+int32_t IdleStack[IDLESTACKSIZE];
+
+uint32_t g_stackOverflows;  // number of threads caught running off the bottom of their stack
+int32_t g_lastOverflowID;   // ID of the last one
+
+#ifdef PROFILE
+// CPU time is charged to RunPt on every switch, less the time spent in
+// timer tasks and SysTick meanwhile, which is charged to them instead
+#define CPUSNAPSHOT (1000*TIME_1MS) // utilization is recomputed every second
+#define CPUISRS (TIMER_NUMTIMERS+1) // the timer tasks, then SysTick
+void static Cpu_Snapshot(void);
+volatile uint32_t g_isrTime;  // free running bus cycles spent in timer tasks and SysTick
+uint32_t g_chargeTime;        // OS_Time when RunPt was last charged
+uint32_t g_chargeIsr;         // g_isrTime then
+unsigned long long SysTickTotal; // bus cycles spent in SysTick_Handler
+unsigned long long IsrLast[CPUISRS]; // totals at the last snapshot
+uint32_t IsrPercent[CPUISRS];  // 0.1% units of the CPU over the last snapshot
+uint32_t g_snapshotTime;      // OS_Time of the last snapshot
+OSTimerType CpuTimer;         // takes the snapshots
+
+// ******** Cpu_Charge ************
+// add the time RunPt ran since it was last charged to its RunTime
+// g_isrTime holds each timer task and SysTick call once, less the calls
+// nested in it, so nested interrupts are not taken off the thread twice,
+// an interrupt that nests in something else (GPIO, UART, ADC) is still
+// charged to the thread it interrupted
+// must be called with interrupts disabled
+void static Cpu_Charge(uint32_t now){
+	uint32_t elapsed = now - g_chargeTime;
+	uint32_t isr = g_isrTime - g_chargeIsr;
+	if(isr < elapsed){ // an interrupt that straddles the switch can make it larger
+		RunPt->RunTime += elapsed - isr;
+	}
+	g_chargeTime = now;
+	g_chargeIsr += isr;
+}
+#endif
+
+#ifdef TRACE
+// the last TRACESIZE scheduler events, dumped over the UART by OS_TraceDump
+#define TRACESIZE 256      // records, power of 2
+#define TRACEMAGIC "TRCE"
+struct tracerecord{
+	uint32_t Time;     // OS_Time, 12.5ns units
+	uint8_t Event;     // TRACE_SWITCH ... in OS.h
+	uint8_t Thread;    // slot of the running thread, the low byte of its ID
+	uint16_t Arg;      // meaning depends on the event
+};
+struct tracerecord TraceBuf[TRACESIZE];
+volatile uint32_t g_traceI; // free running, the next record goes to g_traceI%TRACESIZE
+uint32_t g_traceOn = 1;    // cleared while the buffer is dumped
+
+// ******** OS_Trace ************
+// add one record to the trace buffer, overwriting the oldest one
+// input:  event code and its argument, only the low 16 bits are kept
+// output: none
+// can be called from interrupt handlers, takes about 30 bus cycles
+// interrupts stay enabled, the slot is claimed with LDREX/STREX so the
+// lock-free FIFO and the timer handlers are not held up by tracing, an
+// interrupt that records between the claim and the time stamp can leave
+// two neighbouring records a few cycles out of order
+void OS_Trace(unsigned long event, unsigned long arg){
+	struct tracerecord *rec;
+	uint32_t i;
+	if(!g_traceOn){
+		return;
+	}
+#ifdef __CC_ARM
+	do{
+		i = __ldrex(&g_traceI);
+	}while(__strex(i+1, &g_traceI)); // retry if an interrupt claimed one meanwhile
+#else
+	i = __atomic_fetch_add(&g_traceI, 1, __ATOMIC_RELAXED);
+#endif
+	rec = &TraceBuf[i&(TRACESIZE-1)];
+	rec->Time = OS_Time();
+	rec->Event = event;
+	rec->Thread = (RunPt != NULL) ? RunPt->ID : 0xFF;
+	rec->Arg = arg;
+}
+#define TRACE_EVENT(event,arg) OS_Trace(event, arg)
+#else
+#define TRACE_EVENT(event,arg)
+void OS_Trace(unsigned long event, unsigned long arg){;}
+#endif
 
 
 
-#define FIFOMAXSIZE 128
+// storage for the Fifo used by OS_Fifo_Init, OS_Fifo_Put and OS_Fifo_Get
+#define FIFOMAXSIZE 128    // power of 2
 #define FIFO_SUCCESS 1
 #define FIFO_FAIL 0
-unsigned long *g_fifoPutPtr, *g_fifoGetPtr;
 unsigned long Fifo[FIFOMAXSIZE];
-unsigned long* g_Fifo;
-unsigned int g_FIFOSIZE;
+OSFifoType OSFifo;
+#ifdef __CC_ARM
+#define DMB() __dmb(0xF)   // data memory barrier
+#else
+#define DMB() __sync_synchronize()
+#endif
 
 
 
 volatile int mutex;
 volatile int RoomLeft;
 volatile int CurrentSize;
-Sema4Type LCDmutex;
+OSMutexType LCDmutex;
 unsigned long g_mailboxData;
-unsigned long* g_ulFifo; // pointer to OS_FIFO
-
-void SetInitialStack(int i){
-  tcbs[i].sp = &Stacks[i][STACKSIZE-16]; // thread stack pointer
-  Stacks[i][STACKSIZE-1] = 0x01000000;   // thumb bit
-  Stacks[i][STACKSIZE-3] = 0x14141414;   // R14
-  Stacks[i][STACKSIZE-4] = 0x12121212;   // R12
-  Stacks[i][STACKSIZE-5] = 0x03030303;   // R3
-  Stacks[i][STACKSIZE-6] = 0x02020202;   // R2
-  Stacks[i][STACKSIZE-7] = 0x01010101;   // R1
-  Stacks[i][STACKSIZE-8] = 0x00000000;   // R0
-  Stacks[i][STACKSIZE-9] = 0x11111111;   // R11
-  Stacks[i][STACKSIZE-10] = 0x10101010;  // R10
-  Stacks[i][STACKSIZE-11] = 0x09090909;  // R9
-  Stacks[i][STACKSIZE-12] = 0x08080808;  // R8
-  Stacks[i][STACKSIZE-13] = 0x07070707;  // R7
-  Stacks[i][STACKSIZE-14] = 0x06060606;  // R6
-  Stacks[i][STACKSIZE-15] = 0x05050505;  // R5
-  Stacks[i][STACKSIZE-16] = 0x04040404;  // R4
+
+// stack is an array of size words, the thread starts at the top of it
+// the rest is painted so the peak use can be found later
+void SetInitialStack(tcbType *thread, int32_t *stack, uint32_t size){
+  uint32_t i;
+  for(i=0; i<size-16; i++){
+    stack[i] = STACKPAINT;
+  }
+  thread->StackBase = stack;
+  thread->StackSize = size;
+  thread->StackOverflow = 0;
+  thread->sp = &stack[size-16]; // thread stack pointer
+  stack[size-1] = 0x01000000;   // thumb bit
+  stack[size-3] = 0x14141414;   // R14
+  stack[size-4] = 0x12121212;   // R12
+  stack[size-5] = 0x03030303;   // R3
+  stack[size-6] = 0x02020202;   // R2
+  stack[size-7] = 0x01010101;   // R1
+  stack[size-8] = 0x00000000;   // R0
+  stack[size-9] = 0x11111111;   // R11
+  stack[size-10] = 0x10101010;  // R10
+  stack[size-11] = 0x09090909;  // R9
+  stack[size-12] = 0x08080808;  // R8
+  stack[size-13] = 0x07070707;  // R7
+  stack[size-14] = 0x06060606;  // R6
+  stack[size-15] = 0x05050505;  // R5
+  stack[size-16] = 0x04040404;  // R4
+}
+
+// ******** Stack_Alloc ************
+// first fit allocation from the stack arena
+// input:  pointer to the number of words wanted, even and at least MINSTACKSIZE,
+//         set to the number of words actually given
+// output: lowest address of the stack, NULL if no free block is big enough
+// must be called with interrupts disabled
+int32_t static *Stack_Alloc(uint32_t *size){
+	freeblockType **pt = &FreeStacks;
+	freeblockType *block;
+	while(*pt != NULL){
+		block = *pt;
+		if(block->Size >= *size){
+			if(block->Size - *size >= MINSTACKSIZE){ // split, the low part stays free
+				block->Size -= *size;
+				return (int32_t *)block + block->Size;
+			}
+			*pt = block->Next;   // too small to split, take all of it
+			*size = block->Size;
+			return (int32_t *)block;
+		}
+		pt = &block->Next;
+	}
+	return NULL;
+}
+
+// ******** Stack_Free ************
+// return a stack to the arena, merging it with free neighbors
+// must be called with interrupts disabled
+void static Stack_Free(int32_t *stack, uint32_t size){
+	freeblockType *block = (freeblockType *)stack;
+	freeblockType *previous = NULL;
+	freeblockType *pt = FreeStacks;
+	while((pt != NULL) && (pt < block)){
+		previous = pt;
+		pt = pt->Next;
+	}
+	block->Size = size;
+	block->Next = pt;
+	if((pt != NULL) && ((int32_t *)block + size == (int32_t *)pt)){ // merge with the one above
+		block->Size += pt->Size;
+		block->Next = pt->Next;
+	}
+	if(previous == NULL){
+		FreeStacks = block;
+	}else if((int32_t *)previous + previous->Size == (int32_t *)block){ // merge with the one below
+		previous->Size += block->Size;
+		previous->Next = block->Next;
+	}else{
+		previous->Next = block;
+	}
+}
+
+// true if a thread runs above the level it was added at because a mutex
+// lent it a higher one, at OS_EDFPRIORITY that is a plain thread since
+// nothing else is added there
+#define LENT(t) ((t)->Priority < (t)->BasePriority)
+// true if EDF thread a is due before thread b, threads that are lent
+// OS_EDFPRIORITY by a mutex come before every EDF thread
+#define EDF_BEFORE(a,b) (!LENT(b) && ((int32_t)((a)->Deadline - (b)->Deadline) < 0))
+
+// ******** ReadyList_Add ************
+// append a thread to the tail of the ready list for its priority, at
+// OS_EDFPRIORITY an EDF thread goes in front of the first one due after it
+// must be called with interrupts disabled
+void static ReadyList_Add(tcbType *thread){
+	int32_t priority = thread->Priority;
+	tcbType *head = ReadyList[priority];
+	tcbType *pt;
+	if(head == NULL){
+		thread->next = thread;
+		thread->previous = thread;
+		ReadyList[priority] = thread;
+		g_readyBitmap |= PRIORITYBIT(priority);
+	}else{ // goes just before pt, the tail is just before the head
+		pt = head;
+		if((priority == OS_EDFPRIORITY) && LENT(thread)){
+			ReadyList[priority] = thread; // lent this level by a mutex, runs first
+		}else if(priority == OS_EDFPRIORITY){
+			while(!EDF_BEFORE(thread, pt)){
+				pt = pt->next;
+				if(pt == head){
+					break; // due last, goes to the tail
+				}
+			}
+			if(EDF_BEFORE(thread, head)){
+				ReadyList[priority] = thread; // due first
+			}
+		}
+		thread->next = pt;
+		thread->previous = pt->previous;
+		pt->previous->next = thread;
+		pt->previous = thread;
+	}
+}
+
+// ******** ReadyList_Remove ************
+// unlink a thread from the ready list for its priority
+// must be called with interrupts disabled
+void static ReadyList_Remove(tcbType *thread){
+	int32_t priority = thread->Priority;
+	if(thread->next == thread){ // last thread at this priority
+		ReadyList[priority] = NULL;
+		g_readyBitmap &= ~PRIORITYBIT(priority);
+	}else{
+		thread->previous->next = thread->next;
+		thread->next->previous = thread->previous;
+		if(ReadyList[priority] == thread){
+			ReadyList[priority] = thread->next;
+		}
+	}
+}
+
+// ******** SleepList_Add ************
+// put a thread to sleep for sleepTime ms, it goes behind any thread
+// that wakes up at the same time
+// must be called with interrupts disabled
+void static SleepList_Add(tcbType *thread, int32_t sleepTime){
+	tcbType *pt = SleepList;
+	tcbType *previous = NULL;
+	while((pt != NULL) && (pt->SleepCtr <= sleepTime)){
+		sleepTime -= pt->SleepCtr;
+		previous = pt;
+		pt = pt->SleepNext;
+	}
+	thread->SleepCtr = sleepTime;
+	thread->SleepNext = pt;
+	thread->SleepPrevious = previous;
+	if(pt != NULL){
+		pt->SleepCtr -= sleepTime; // the one behind now counts from this thread
+		pt->SleepPrevious = thread;
+	}
+	if(previous != NULL){
+		previous->SleepNext = thread;
+	}else{
+		SleepList = thread;
+	}
+}
+
+// ******** SleepList_Remove ************
+// take a thread out of the sleep list before its time is up, the thread
+// behind it gets its remaining time
+// must be called with interrupts disabled
+void static SleepList_Remove(tcbType *thread){
+	if(thread->SleepNext != NULL){
+		thread->SleepNext->SleepCtr += thread->SleepCtr;
+		thread->SleepNext->SleepPrevious = thread->SleepPrevious;
+	}
+	if(thread->SleepPrevious != NULL){
+		thread->SleepPrevious->SleepNext = thread->SleepNext;
+	}else{
+		SleepList = thread->SleepNext;
+	}
+	thread->SleepPrevious = NULL;
+	thread->SleepNext = NULL;
+}
+
+// ******** SleepList_Contains ************
+// true if the thread is waiting for its time to be up
+// must be called with interrupts disabled
+int static SleepList_Contains(tcbType *thread){
+	return (thread->SleepPrevious != NULL) || (SleepList == thread);
+}
+
+void static BlockedList_Unlink(tcbType *thread);
+
+// ******** SleepList_Advance ************
+// let elapsed ms pass, every thread whose time is up goes back to its ready list
+// cost depends on the number of wakeups, not the number of sleeping threads
+// must be called with interrupts disabled
+void static SleepList_Advance(int32_t elapsed){
+	tcbType *thread;
+	while((SleepList != NULL) && (SleepList->SleepCtr <= elapsed)){
+		thread = SleepList;
+		elapsed -= thread->SleepCtr;
+		SleepList = thread->SleepNext;
+		if(SleepList != NULL){
+			SleepList->SleepPrevious = NULL;
+		}
+		thread->SleepCtr = 0;
+		thread->SleepNext = NULL;
+		if(thread->BlockPt != NULL){ // OS_WaitTimeout ran out, give the unit back
+			thread->BlockPt->Value++;
+			BlockedList_Unlink(thread);
+			thread->TimedOut = 1;
+		}
+		ReadyList_Add(thread);
+	}
+	if(SleepList != NULL){
+		SleepList->SleepCtr -= elapsed;
+	}
+}
+
+// ******** TimeAdvance ************
+// account for bus cycles of elapsed time, whole ms go to g_msTime and the
+// sleep list, the rest is carried to the next call
+// must be called with interrupts disabled
+void static TimeAdvance(uint32_t cycles){
+	uint32_t ms;
+	g_cycleResidue += cycles;
+	ms = g_cycleResidue/TIME_1MS;
+	if(ms > 0){
+		g_cycleResidue -= ms*TIME_1MS;
+		g_msTime += ms;
+		g_upTime += ms;
+		SleepList_Advance(ms);
+	}
+}
+
+#ifdef TICKLESS
+// bus cycles from the CURRENT read in SysTick_Elapsed to the write that
+// clears it in SysTick_Restart, plus the one the reload takes, estimated
+// from the instructions in between
+#define SYSTICK_RESTARTCYCLES 8
+#define TICKLESSMIN 100     // bus cycles, shortest stretched period worth setting up
+uint32_t g_tickCounted;     // bus cycles of the current SysTick period already counted
+
+// ******** SysTick_Elapsed ************
+// bus cycles since the last SysTick interrupt was serviced, less what an
+// earlier call in the same period returned, a tick that is already pending
+// is counted here and cancelled
+uint32_t static SysTick_Elapsed(void){
+	uint32_t elapsed = 0;
+	uint32_t now = NVIC_ST_RELOAD_R - NVIC_ST_CURRENT_R;
+	if(NVIC_INT_CTRL_R&NVIC_INT_CTRL_PENDSTSET){ // wrapped, maybe after the read
+		NVIC_INT_CTRL_R = NVIC_INT_CTRL_PENDSTCLR;
+		elapsed = NVIC_ST_RELOAD_R + 1 - g_tickCounted;
+		g_tickCounted = 0;
+		now = NVIC_ST_RELOAD_R - NVIC_ST_CURRENT_R;
+	}
+	elapsed += now - g_tickCounted;
+	g_tickCounted = now;
+	return elapsed;
+}
+
+// ******** SysTick_Restart ************
+// start a new SysTick period of the given number of bus cycles right now,
+// the cycles of the old period up to the restart go into g_cycleResidue
+// so no time is lost, TimeAdvance turns them into ms at its next call
+void static SysTick_Restart(uint32_t period){
+	g_cycleResidue += SysTick_Elapsed() + SYSTICK_RESTARTCYCLES;
+	NVIC_ST_RELOAD_R = period - 1;
+	NVIC_ST_CURRENT_R = 0;      // any write to current clears it
+	g_tickCounted = 0;
+}
+
+// ******** Tickless_Enter ************
+// called by the idle thread with interrupts disabled when nothing is ready,
+// stretches the SysTick period to the earliest wakeup so the processor
+// sleeps through the ticks in between
+void static Tickless_Enter(void){
+	uint32_t period;
+	TimeAdvance(SysTick_Elapsed()); // the part of this period that is already gone
+	if(g_readyBitmap != 0){         // and that woke somebody up
+		g_ticklessPeriod = 0;
+		SysTick_Restart(g_timeSlice);
+		NVIC_INT_CTRL_R = NVIC_INT_CTRL_PEND_SV;
+		return;
+	}
+	if((SleepList == NULL) || (SleepList->SleepCtr >= SYSTICK_MAX/TIME_1MS)){
+		period = SYSTICK_MAX; // wake up now and then anyway, the counter is only 24 bits
+	}else{
+		period = SleepList->SleepCtr*TIME_1MS - g_cycleResidue;
+	}
+	if(period < TICKLESSMIN){ // less than a slice is fine, a slice would wake it late
+		period = TICKLESSMIN;
+	}
+	g_ticklessPeriod = period;
+	SysTick_Restart(period);
+}
+
+// ******** Tickless_Exit ************
+// called with interrupts disabled when a thread is ready again before
+// the stretched period ran out, counts the time spent idle and
+// goes back to one interrupt per time slice
+void static Tickless_Exit(void){
+	TimeAdvance(SysTick_Elapsed());
+	g_ticklessPeriod = 0;
+	SysTick_Restart(g_timeSlice);
+}
+#endif
+
+// ******** Preempt ************
+// request a context switch if thread should run ahead of the running thread
+// must be called with interrupts disabled
+void static Preempt(tcbType *thread){
+	if((RunPt != NULL) && ((thread->Priority < RunPt->Priority) ||
+	   ((thread->Priority == OS_EDFPRIORITY) && (RunPt->Priority == OS_EDFPRIORITY) &&
+	    !LENT(thread) && EDF_BEFORE(thread, RunPt)))){
+		NVIC_INT_CTRL_R = NVIC_INT_CTRL_PEND_SV;
+	}
+}
+
+// ******** Scheduler ************
+// called by PendSV_Handler with interrupts disabled
+// sets RunPt to the highest priority ready thread in constant time,
+// threads of equal priority are run round robin, except at OS_EDFPRIORITY
+// where the list is kept in deadline order and the head always runs
+void Scheduler(void){
+	int32_t priority;
+#ifdef TRACE
+	uint32_t previous = RunPt->ID;
+#endif
+#ifdef PROFILE
+	Cpu_Charge(OS_Time());
+#endif
+	if((RunPt->StackBase != NULL) && (RunPt->StackOverflow == 0) &&
+	   ((RunPt->sp < RunPt->StackBase) || (RunPt->StackBase[0] != STACKPAINT))){
+		// the canary is gone, whatever sits below this stack may be corrupted
+		RunPt->StackOverflow = 1;
+		g_stackOverflows++;
+		g_lastOverflowID = RunPt->ID;
+	}
+	if(RunPt->MemStatus == ZOMBIE){
+		// killed thread, nothing runs on its TCB or stack anymore so both can
+		// be reused, the stack stays with the TCB for a thread of the same size
+		RunPt->MemStatus = FREE;
+		RunPt->next = FreeTcbs;
+		FreeTcbs = RunPt;
+	}
+	if(g_readyBitmap == 0){
+		RunPt = &IdleTcb;  // everybody is sleeping or blocked
+	}else{
+#ifdef TICKLESS
+		if(g_ticklessPeriod != 0){ // woken up early by some other interrupt
+			Tickless_Exit();
+		}
+#endif
+		priority = CLZ(g_readyBitmap);
+		RunPt = ReadyList[priority];
+		if(priority != OS_EDFPRIORITY){
+			ReadyList[priority] = RunPt->next; // rotate, the next equal priority thread goes after this one
+		}
+	}
+	TRACE_EVENT(TRACE_SWITCH, previous&0xFF); // recorded as the new thread
+}
+
+// ******** IdleThread ************
+// sleeps until the next interrupt, with TICKLESS defined the SysTick
+// interrupts in between are skipped as well
+void static IdleThread(void){
+	int32_t status;
+	for(;;){
+		status = StartCritical();
+#ifdef TICKLESS
+		if(g_readyBitmap == 0){
+			Tickless_Enter();
+		}
+#endif
+		WaitForInterrupt();  // wakes up on a pending interrupt even with I=1
+		EndCritical(status); // the interrupt is serviced here
+	}
 }
 
 // ******** OS_Init ************
@@ -95,6 +634,7 @@ void SetInitialStack(int i){
 // Timer1 used for OS system time
 void OS_Init(void){
 	uint32_t delay;
+	int32_t k;
 	OS_DisableInterrupts();
   PLL_Init();                 // set processor clock to 80 MHz
 	SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R1;   // activate timer1
@@ -102,15 +642,52 @@ void OS_Init(void){
 	TIMER1_CTL_R &= ~TIMER_CTL_TAEN; // disable TimerA1
 	TIMER1_CFG_R  = TIMER_CFG_32_BIT_TIMER; // configure for 32-bit mode
 	TIMER1_TAMR_R = TIMER_TAMR_TAMR_PERIOD;
-	TIMER1_TAILR_R = (0x01<<31)-1;
+	TIMER1_TAILR_R = 0xFFFFFFFF;  // full 32 bits, wraps every 53.7 s
 	TIMER1_TAPR_R = 0; // set prescale = 0
-	TIMER1_CTL_R |= TIMER_CTL_TAEN; // disable TimerA0
+	g_timeHigh = 0;
+	HandlerTaskArray[OSTIMER] = &OS_TimeOverflow; // called by Timer1A_Handler
+	TIMER_Reserve(OSTIMER);
+	TIMER1_ICR_R = TIMER_ICR_TATOCINT;
+	TIMER1_IMR_R |= TIMER_IMR_TATOIM; // interrupt on every wrap
+	// priority 0, so nothing can run between TIMER_Dispatch clearing the
+	// timeout and OS_TimeOverflow counting it, when OS_Time64 would miss it
+	NVIC_PRI5_R = (NVIC_PRI5_R & ~NVIC_PRI5_INT21_M)|(0 << NVIC_PRI5_INT21_S); // priority 0
+	NVIC_EN0_R = NVIC_EN0_INT21;
+	TIMER1_CTL_R |= TIMER_CTL_TAEN; // enable TimerA1
+	SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R5;   // activate timer5 for the software timers
+	delay = SYSCTL_RCGCTIMER_R;
+	TIMER5_CTL_R &= ~TIMER_CTL_TAEN;
+	TIMER5_CFG_R = TIMER_CFG_32_BIT_TIMER;
+	TIMER5_TAMR_R = TIMER_TAMR_TAMR_1_SHOT;
+	TIMER5_TAPR_R = 0;
+	g_numTimers = 0;
+	HandlerTaskArray[SWTIMER] = &SWTimer_Handler; // called by Timer5A_Handler
+	TIMER_Reserve(SWTIMER);
+	TIMER5_ICR_R = TIMER_ICR_TATOCINT;
+	TIMER5_IMR_R |= TIMER_IMR_TATOIM;
+	NVIC_PRI23_R = (NVIC_PRI23_R & ~NVIC_PRI23_INTA_M)|(2 << NVIC_PRI23_INTA_S); // priority 2
+	NVIC_EN2_R = NVIC_EN2_INT92;
 	#ifdef SYSTICK
   NVIC_ST_CTRL_R = 0;         // disable SysTick during setup
   NVIC_SYS_PRI3_R =(NVIC_SYS_PRI3_R & ~NVIC_SYS_PRI3_TICK_M)|(0x7 << NVIC_SYS_PRI3_TICK_S); // priority 7
 	
 	#endif
 	NVIC_SYS_PRI3_R = (NVIC_SYS_PRI3_R&(~NVIC_SYS_PRI3_PENDSV_M))|(0x7 << NVIC_SYS_PRI3_PENDSV_S); // PendSV priority 7
+	FreeStacks = (freeblockType *)StackArena; // one free block spanning the arena
+	FreeStacks->Size = STACKARENASIZE;
+	FreeStacks->Next = NULL;
+	FreeTcbs = NULL;
+	for(k=NUMTHREADS-1; k>=0; k--){ // slot 0 ends up first
+		tcbs[k].MemStatus = FREE;
+		tcbs[k].StackBase = NULL;
+		tcbs[k].next = FreeTcbs;
+		FreeTcbs = &tcbs[k];
+	}
+	IdleTcb.ID = NUMTHREADS; // generation 0, no real thread has it
+	IdleTcb.Priority = NUMPRIORITIES; // below every real thread
+	IdleTcb.MemStatus = USED;
+	SetInitialStack(&IdleTcb, IdleStack, IDLESTACKSIZE);
+	IdleStack[IDLESTACKSIZE-2] = (int32_t)(&IdleThread); // PC
 	//NVIC_SYS_HND_CTRL_R |= NVIC_SYS_HND_CTRL_PNDSV; //enable PendSV
 }
 
@@ -122,35 +699,142 @@ void OS_InitSemaphore(Sema4Type *semaPt, long value){
 	int32_t status;
 	status = StartCritical();
 	semaPt->Value = value;
+	semaPt->Blocked = NULL;
 	EndCritical(status);
 }
 
+// ******** BlockedList_Add ************
+// put a thread in line on a semaphore, higher priority threads go
+// ahead of lower ones and equal priorities are first come first served
+// the thread is not in a ready list, so its next pointer is free to use
+// must be called with interrupts disabled
+void static BlockedList_Add(Sema4Type *semaPt, tcbType *thread){
+	tcbType **pt = &semaPt->Blocked;
+	while((*pt != NULL) && ((*pt)->Priority <= thread->Priority)){
+		pt = &((*pt)->next);
+	}
+	thread->next = *pt;
+	*pt = thread;
+	thread->BlockPt = semaPt;
+}
+
+// ******** BlockedList_Unlink ************
+// take a thread that gave up waiting out of line, it is not made ready here
+// must be called with interrupts disabled
+void static BlockedList_Unlink(tcbType *thread){
+	tcbType **pt = &thread->BlockPt->Blocked;
+	while(*pt != thread){
+		pt = &((*pt)->next);
+	}
+	*pt = thread->next;
+	thread->BlockPt = NULL;
+}
+
+// ******** BlockedList_Remove ************
+// take the first thread in line off a semaphore and make it ready
+// must be called with interrupts disabled, and the list must not be empty
+void static BlockedList_Remove(Sema4Type *semaPt){
+	tcbType *thread = semaPt->Blocked;
+	semaPt->Blocked = thread->next;
+	thread->BlockPt = NULL;
+	if(SleepList_Contains(thread)){ // signaled before its timeout
+		SleepList_Remove(thread);
+	}
+	ReadyList_Add(thread);
+	Preempt(thread);
+}
+
+// ******** Priority_Set ************
+// change the running priority of a thread wherever it is, a ready list is
+// switched, a blocked list is kept sorted, and if the thread waits on a
+// mutex whose owner runs below the new priority, the owner is raised too
+// must be called with interrupts disabled
+void static Priority_Set(tcbType *thread, int32_t priority){
+	Sema4Type *blockPt;
+	while(thread->Priority != priority){
+		if(thread->BlockPt != NULL){ // waiting in line, move to its new place
+			blockPt = thread->BlockPt;
+			BlockedList_Unlink(thread);
+			thread->Priority = priority;
+			BlockedList_Add(blockPt, thread);
+		}else if(SleepList_Contains(thread) || (thread->MemStatus != USED)){
+			thread->Priority = priority; // in no ready list
+		}else{
+			ReadyList_Remove(thread);
+			thread->Priority = priority;
+			ReadyList_Add(thread);
+			Preempt(thread);
+		}
+		if((thread->WaitMutex == NULL) || (thread->WaitMutex->Owner->Priority <= priority)){
+			return;
+		}
+		thread = thread->WaitMutex->Owner; // pass it along the chain
+	}
+}
+
 // DA 2/18
 // ******** OS_Wait ************
 // decrement semaphore 
-// Lab2 spinlock
-// Lab3 block if less than zero
+// block if less than zero, the thread leaves the ready lists until signaled
 // input:  pointer to a counting semaphore
 // output: none
 // From book pg. 191
 void OS_Wait(Sema4Type *semaPt){
-	
-	OS_DisableInterrupts();
-	while(semaPt->Value <= 0)
-	{
-		OS_EnableInterrupts();
+	int32_t status;
+	status = StartCritical();
+	TRACE_EVENT(TRACE_WAIT, (uint32_t)semaPt);
+	semaPt->Value = semaPt->Value - 1;
+	if(semaPt->Value < 0)
+	{ // no units left, wait in line for OS_Signal
+		TRACE_EVENT(TRACE_BLOCK, (uint32_t)semaPt);
+		ReadyList_Remove(RunPt);
+		BlockedList_Add(semaPt, RunPt);
 		OS_Suspend();
-		OS_DisableInterrupts();
 	}
-	semaPt->Value = semaPt->Value - 1;
-	OS_EnableInterrupts();
+	EndCritical(status); // context switch happens here if blocked
 }	
 
+// ******** OS_WaitTimeout ************
+// decrement a counting semaphore, waiting at most timeout ms for it
+// input:  pointer to a counting semaphore, ms to wait, 0 does not wait
+// output: 1 if the semaphore was taken, 0 if the time ran out
+int OS_WaitTimeout(Sema4Type *semaPt, unsigned long timeout){
+	int32_t status;
+	status = StartCritical();
+	TRACE_EVENT(TRACE_WAIT, (uint32_t)semaPt);
+	if(semaPt->Value > 0){
+		semaPt->Value = semaPt->Value - 1;
+		EndCritical(status);
+		return 1;
+	}
+	if(timeout == 0){
+		EndCritical(status);
+		return 0;
+	}
+	semaPt->Value = semaPt->Value - 1;
+	TRACE_EVENT(TRACE_BLOCK, (uint32_t)semaPt);
+	ReadyList_Remove(RunPt);
+	BlockedList_Add(semaPt, RunPt);
+	RunPt->TimedOut = 0;
+	SleepList_Add(RunPt, timeout); // whichever comes first takes it out of the other list
+	OS_Suspend();
+	EndCritical(status); // context switch happens here
+	return !RunPt->TimedOut;
+}
+
+// ******** OS_TryWait ************
+// decrement a counting semaphore only if that does not block
+// input:  pointer to a counting semaphore
+// output: 1 if the semaphore was taken, 0 if it was busy
+// can be called from interrupt handlers
+int OS_TryWait(Sema4Type *semaPt){
+	return OS_WaitTimeout(semaPt, 0);
+}
+
 // DA 2/18
 // ******** OS_Signal ************
 // increment semaphore 
-// Lab2 spinlock
-// Lab3 wakeup blocked thread if appropriate 
+// wakeup the highest priority blocked thread if appropriate 
 // input:  pointer to a counting semaphore
 // output: none
 // From book pg. 191
@@ -158,129 +842,373 @@ void OS_Signal(Sema4Type *semaPt)
 {	
 	int32_t status;
 	status = StartCritical();
+	TRACE_EVENT(TRACE_SIGNAL, (uint32_t)semaPt);
 	semaPt->Value = semaPt->Value + 1;
+	if(semaPt->Value <= 0)
+	{ // somebody is waiting, the unit goes straight to them
+		BlockedList_Remove(semaPt);
+	}
 	EndCritical(status);
 }	
 
 // DA 2/18
 // ******** OS_bWait ************
-// Lab2 spinlock, set to 0
-// Lab3 block if less than zero
+// set to 0 if free, otherwise block until signaled
 // input:  pointer to a binary semaphore
 // output: none
 void OS_bWait(Sema4Type *semaPt){
-	
-	OS_DisableInterrupts();
-	while(semaPt->Value == 0)
+	int32_t status;
+	status = StartCritical();
+	TRACE_EVENT(TRACE_WAIT, (uint32_t)semaPt);
+	if(semaPt->Value > 0)
 	{
-		OS_EnableInterrupts();
-		OS_Suspend();										//cooperative
-		OS_DisableInterrupts();
+		semaPt->Value = 0;
+	}
+	else
+	{ // OS_bSignal hands the semaphore over while leaving it at 0
+		TRACE_EVENT(TRACE_BLOCK, (uint32_t)semaPt);
+		ReadyList_Remove(RunPt);
+		BlockedList_Add(semaPt, RunPt);
+		OS_Suspend();
 	}
-	// it exits while loop once 
-	// semaphore has been signaled
-	semaPt->Value = 0;
-	OS_EnableInterrupts();
+	EndCritical(status);
 }
 
 // DA 2/18
 // ******** OS_bSignal ************
-// Lab2 spinlock, set to 1
-// Lab3 wakeup blocked thread if appropriate 
+// wakeup the highest priority blocked thread, set to 1 if nobody is waiting
 // input:  pointer to a binary semaphore
 // output: none
 void OS_bSignal(Sema4Type *semaPt)
 {
-	semaPt->Value = 1; // atomic
+	int32_t status;
+	status = StartCritical();
+	TRACE_EVENT(TRACE_SIGNAL, (uint32_t)semaPt);
+	if(semaPt->Blocked != NULL)
+	{
+		BlockedList_Remove(semaPt);
+	}
+	else
+	{
+		semaPt->Value = 1;
+	}
+	EndCritical(status);
+}
+
+// ******** OS_MutexInit ************
+// initialize a mutex to be free
+// input:  pointer to the mutex
+// output: none
+void OS_MutexInit(OSMutexType *mutexPt){
+	int32_t status;
+	status = StartCritical();
+	mutexPt->Owner = NULL;
+	mutexPt->Count = 0;
+	mutexPt->NextHeld = NULL;
+	OS_InitSemaphore(&mutexPt->Waiters, 0);
+	EndCritical(status);
+}
+
+// ******** Mutex_Take ************
+// make thread the owner of a free mutex
+// must be called with interrupts disabled
+void static Mutex_Take(OSMutexType *mutexPt, tcbType *thread){
+	mutexPt->Owner = thread;
+	mutexPt->Count = 1;
+	mutexPt->NextHeld = thread->Held;
+	thread->Held = mutexPt;
+}
+
+// ******** OS_MutexLock ************
+// take a mutex, blocking until it is free, the owner can take it again
+// a lower priority owner is raised to the priority of the running thread
+// until it unlocks, so medium priority threads can not hold both up
+// input:  pointer to the mutex
+// output: none
+// before OS_Launch only main runs, so the call does nothing then
+void OS_MutexLock(OSMutexType *mutexPt){
+	int32_t status;
+	if(RunPt == NULL){ // no thread to own it or exclude
+		return;
+	}
+	status = StartCritical();
+	TRACE_EVENT(TRACE_WAIT, (uint32_t)mutexPt);
+	if(mutexPt->Owner == NULL){
+		Mutex_Take(mutexPt, RunPt);
+	}else if(mutexPt->Owner == RunPt){
+		mutexPt->Count++;
+	}else{ // OS_MutexUnlock hands it over before this thread runs again
+		TRACE_EVENT(TRACE_BLOCK, (uint32_t)mutexPt);
+		ReadyList_Remove(RunPt);
+		BlockedList_Add(&mutexPt->Waiters, RunPt);
+		RunPt->WaitMutex = mutexPt;
+		if(mutexPt->Owner->Priority > RunPt->Priority){
+			Priority_Set(mutexPt->Owner, RunPt->Priority);
+		}
+		OS_Suspend();
+	}
+	EndCritical(status); // context switch happens here if blocked
+}
+
+// ******** OS_MutexTryLock ************
+// take a mutex only if that does not block
+// input:  pointer to the mutex
+// output: 1 if it was taken, 0 if another thread owns it
+// before OS_Launch it always succeeds and records nothing
+int OS_MutexTryLock(OSMutexType *mutexPt){
+	int32_t status;
+	int taken = 1;
+	if(RunPt == NULL){
+		return 1;
+	}
+	status = StartCritical();
+	if(mutexPt->Owner == NULL){
+		Mutex_Take(mutexPt, RunPt);
+	}else if(mutexPt->Owner == RunPt){
+		mutexPt->Count++;
+	}else{
+		taken = 0;
+	}
+	EndCritical(status);
+	return taken;
+}
+
+// ******** OS_MutexUnlock ************
+// undo one OS_MutexLock, the last one hands the mutex to the highest
+// priority waiter, the owner drops to the highest of its own priority and
+// the waiters of the mutexes it still holds
+// input:  pointer to the mutex
+// output: none
+// does nothing before OS_Launch, matching OS_MutexLock
+void OS_MutexUnlock(OSMutexType *mutexPt){
+	int32_t status;
+	int32_t priority;
+	OSMutexType **held;
+	tcbType *next;
+	if(RunPt == NULL){
+		return;
+	}
+	status = StartCritical();
+	if((mutexPt->Owner != RunPt) || (--mutexPt->Count != 0)){
+		EndCritical(status);
+		return;
+	}
+	TRACE_EVENT(TRACE_SIGNAL, (uint32_t)mutexPt);
+	held = &RunPt->Held;
+	while(*held != mutexPt){
+		held = &((*held)->NextHeld);
+	}
+	*held = mutexPt->NextHeld;
+	priority = RunPt->BasePriority;
+	for(held = &RunPt->Held; *held != NULL; held = &((*held)->NextHeld)){
+		next = (*held)->Waiters.Blocked; // the highest priority waiter is first
+		if((next != NULL) && (next->Priority < priority)){
+			priority = next->Priority;
+		}
+	}
+	if(priority != RunPt->Priority){
+		Priority_Set(RunPt, priority);
+		if((g_readyBitmap != 0) && (CLZ(g_readyBitmap) < priority)){ // someone it kept waiting is ahead now
+			NVIC_INT_CTRL_R = NVIC_INT_CTRL_PEND_SV;
+		}
+	}
+	next = mutexPt->Waiters.Blocked;
+	if(next == NULL){
+		mutexPt->Owner = NULL;
+	}else{ // the waiters left have no higher priority than the new owner
+		Mutex_Take(mutexPt, next);
+		next->WaitMutex = NULL;
+		BlockedList_Remove(&mutexPt->Waiters);
+	}
+	EndCritical(status);
+}
+
+// ******** Stack_Reclaim ************
+// give the stacks cached on free TCBs back to the arena
+// only needed when the arena can not satisfy an allocation
+// must be called with interrupts disabled
+void static Stack_Reclaim(void){
+	tcbType *pt;
+	for(pt=FreeTcbs; pt!=NULL; pt=pt->next){
+		if(pt->StackBase != NULL){
+			Stack_Free(pt->StackBase, pt->StackSize);
+			pt->StackBase = NULL;
+		}
+	}
+}
+
+// ******** Thread_Add ************
+// the body of OS_AddThread and OS_AddEDFThread, priority is a scheduling
+// level, period is 0 for a fixed priority thread, otherwise the first EDF
+// release is now
+// TCBs come off a free list, and a stack left by a killed thread of the
+// same size is reused, so adding a thread takes constant time in the
+// common case, painting the stack is done with interrupts enabled
+uint32_t g_NumAliveThreads=0;
+int static Thread_Add(void(*task)(void), unsigned long stackSize,
+  unsigned long priority, uint32_t period, uint32_t deadline){
+	uint32_t size;
+	int32_t *stack;
+	tcbType *thread;
+	long status;
+	size = (stackSize+1)&~1; // whole double words keep the next stack aligned
+	if(size < MINSTACKSIZE){
+		size = MINSTACKSIZE;
+	}
+	status = StartCritical();
+	thread = FreeTcbs;
+	if(thread == NULL){ //If max threads have been added return failure
+		EndCritical(status);
+		return 0;
+	}
+	stack = thread->StackBase;
+	if((stack == NULL) || (thread->StackSize != size)){
+		if(stack != NULL){
+			Stack_Free(stack, thread->StackSize);
+			thread->StackBase = NULL;
+		}
+		stack = Stack_Alloc(&size);
+		if(stack == NULL){
+			Stack_Reclaim();
+			stack = Stack_Alloc(&size);
+		}
+		if(stack == NULL){ // arena is full or too fragmented
+			EndCritical(status);
+			return 0;
+		}
+	}
+	FreeTcbs = thread->next;
+	thread->MemStatus = USED; // owned by this call, not in any list yet
+	thread->StackBase = stack;
+	thread->StackSize = size;
+	EndCritical(status);
+	
+	thread->Generation++;
+	if(thread->Generation > IDGENERATIONMAX){
+		thread->Generation = 1;
+	}
+	thread->ID = (thread->Generation<<IDSLOTBITS)|(thread-tcbs); // a stale ID never matches
+	thread->Priority = priority;
+	thread->BasePriority = priority;
+	thread->Held = NULL;
+	thread->WaitMutex = NULL;
+	thread->SleepCtr = 0;
+	thread->BlockPt = NULL;
+	thread->Period = period;
+	thread->RelDeadline = deadline;
+	thread->Jobs = thread->Misses = 0;
+#ifdef PROFILE
+	thread->RunTime = thread->RunLast = 0;
+	thread->Percent = 0;
+#endif
+	SetInitialStack(thread, stack, size); // initializes certain registers to arbitrary values
+	stack[size-2] = (int32_t)(task); // PC
+	
+	status = StartCritical();
+	thread->Release = g_upTime;
+	thread->Deadline = g_upTime + deadline;
+	ReadyList_Add(thread);
+	g_NumAliveThreads++;
+	Preempt(thread); // a higher priority thread runs right away
+	EndCritical(status);
+  return 1;               // successful;
 }
 
 //******** OS_AddThread *************** 
 // add a foregound thread to the scheduler
 // Inputs: pointer to a void/void foreground task
-//         number of bytes allocated for its stack
-//         priority, 0 is highest, 5 is the lowest
+//         number of 32-bit words allocated for its stack
+//         priority, 0 is highest, 7 is the lowest
 // Outputs: 1 if successful, 0 if this thread can not be added
-// stack size must be divisable by 8 (aligned to double word boundary)
-// In Lab 2, you can ignore both the stackSize and priority fields
-// In Lab 3, you can ignore the stackSize fields
-uint32_t g_NumAliveThreads=0;
+// priority 0 runs above the EDF threads, 1 to 7 below them
 int OS_AddThread(void(*task)(void), 
   unsigned long stackSize, unsigned long priority){ 
-	uint32_t k=0, first, second;
-//This implementation statically links threads depending on arbitrary order, and does not support dynamic adding and killing
-//	long status = StartCritical();
-//	if(i>NUMTHREADS){return 0;} //If max threads have been added return failure
-//	tcbs[i].ID=i;
-//	tcbs[i].Priority=priority;
-//	tcbs[i].SleepCtr=0;
-//	if(i>0){
-//		 tcbs[i-1].next = &tcbs[i];  //Set previously added thread's next to the thread just added
-//		 tcbs[i].previous=&tcbs[i-1]; //Create a back link from the thread we just left
-//		 tcbs[i].next = &tcbs[0];			//Set the thread just added's next to the first thread in the linked list
-//	}else{
-//		tcbs[0].next = &tcbs[i];
-//	}
-//	tcbs[0].previous = &tcbs[i];
-//  SetInitialStack(i); // initializes certain registers to arbitrary values
-//	Stacks[i][stackSize-2] = (int32_t)(task); // PC
-//	i++;
-//  EndCritical(status);
-	long status = StartCritical();
-	if(g_NumAliveThreads>=NUMTHREADS){return 0;} //If max threads have been added return failure
-	tcbs[g_NumAliveThreads].ID=g_NumAliveThreads;
-  tcbs[g_NumAliveThreads].Priority=priority;
-	tcbs[g_NumAliveThreads].SleepCtr=0;
-	if(g_NumAliveThreads==0){
-		RunPt=&tcbs[0];     //First thread added at start of OS
-		tcbs[0].next=&tcbs[0];
-		tcbs[0].previous = &tcbs[0];
-		SetInitialStack(0); // initializes certain registers to arbitrary values
-		Stacks[0][stackSize-2] = (int32_t)(task); // PC
-		tcbs[0].MemStatus=USED;
-		g_NumAliveThreads++;
-	}
-
-//	else if(g_NumAliveThreads==1){		//Second thread added to establish a circle
-//		tcbs[0].previous = &tcbs[1];
-//		tcbs[0].next = &tcbs[1];
-//		tcbs[1].next = &tcbs[0];
-//		tcbs[1].previous = &tcbs[0];
-//		SetInitialStack(1); // initializes certain registers to arbitrary values
-//		Stacks[1][stackSize-2] = (int32_t)(task); // PC
-//		tcbs[1].MemStatus=USED;
-//		g_NumAliveThreads++;
-//	}
-	else{
-			for(k=0; k<NUMTHREADS; k++){
-			if(tcbs[k].MemStatus==FREE){
-				if(g_NumAliveThreads==1)
-				{
-					RunPt->previous=&tcbs[k];
-					RunPt->next = &tcbs[k];
-					tcbs[k].next=RunPt;
-					tcbs[k].previous=RunPt;
-					SetInitialStack(k);
-					Stacks[k][stackSize-2] = (int32_t)(task); // PC
-					g_NumAliveThreads++;
-					tcbs[k].MemStatus=USED;
-					break;
-				}else{
-					tcbs[k].next=RunPt->next;
-					RunPt->next->previous = &tcbs[k];
-					tcbs[k].previous=RunPt;
-					RunPt->next=&tcbs[k];
-					SetInitialStack(k); // initializes certain registers to arbitrary values
-					Stacks[k][stackSize-2] = (int32_t)(task); // PC
-					g_NumAliveThreads++;
-					tcbs[k].MemStatus=USED;
-					break;
-				}
-			}
-		}
+	if(priority >= USERPRIORITIES){
+		priority = USERPRIORITIES-1;
+	}
+	return Thread_Add(task, stackSize, PRIORITYLEVEL(priority), 0, 0);
+}
+
+//******** OS_AddEDFThread *************** 
+// add a periodic foreground thread scheduled earliest deadline first
+// Inputs: pointer to a void/void foreground task, a loop that calls
+//         OS_EDFWaitNextPeriod after each job
+//         number of 32-bit words allocated for its stack
+//         period in ms, at least 1
+//         relative deadline in ms, 0 means the end of the period
+// Outputs: 1 if successful, 0 if this thread can not be added
+// it runs at OS_EDFPRIORITY, a level of its own between OS_AddThread
+// priorities 0 and 1
+int OS_AddEDFThread(void(*task)(void), unsigned long stackSize,
+  unsigned long period, unsigned long deadline){
+	if(period == 0){
+		return 0;
+	}
+	if((deadline == 0) || (deadline > period)){
+		deadline = period;
 	}
+	return Thread_Add(task, stackSize, OS_EDFPRIORITY, period, deadline);
+}
 
+//******** OS_EDFWaitNextPeriod *************** 
+// end the current job of an EDF thread and sleep until its next release,
+// a job finished after its deadline counts as a miss, and a job that
+// overran its whole period starts the next one right away, late
+// Inputs: none
+// Outputs: none
+// does nothing for a fixed priority thread
+void OS_EDFWaitNextPeriod(void){
+	int32_t status;
+	uint32_t now;
+	status = StartCritical();
+	if(RunPt->Period == 0){
+		EndCritical(status);
+		return;
+	}
+	now = g_upTime;
+	RunPt->Jobs++;
+	if((int32_t)(now - RunPt->Deadline) > 0){
+		RunPt->Misses++;
+	}
+	ReadyList_Remove(RunPt); // its deadline is about to change
+	RunPt->Release += RunPt->Period;
+	RunPt->Deadline = RunPt->Release + RunPt->RelDeadline;
+	if((int32_t)(RunPt->Release - now) > 0){
+		SleepList_Add(RunPt, RunPt->Release - now); // SysTick puts it back
+	}else{
+		ReadyList_Add(RunPt);  // behind, in line with its new deadline
+	}
+	OS_Suspend();
 	EndCritical(status);
-  return 1;               // successful;
+}
+
+//******** OS_EDFInfo *************** 
+// report the deadline misses of one thread slot
+// Inputs: slot 0 to NUMTHREADS-1
+//         pointers to where the thread ID, period and relative deadline in
+//         ms, jobs finished and jobs finished late go
+// Outputs: 1 if the slot holds an EDF thread, 0 if it does not,
+//          -1 if slot is past the last one
+int OS_EDFInfo(unsigned long slot, unsigned long *id, unsigned long *period,
+  unsigned long *deadline, unsigned long *jobs, unsigned long *misses){
+	tcbType *thread;
+	int32_t status;
+	if(slot >= NUMTHREADS){
+		return -1;
+	}
+	thread = &tcbs[slot];
+	status = StartCritical();
+	if((thread->MemStatus != USED) || (thread->Period == 0)){
+		EndCritical(status);
+		return 0;
+	}
+	*id = thread->ID;
+	*period = thread->Period;
+	*deadline = thread->RelDeadline;
+	*jobs = thread->Jobs;
+	*misses = thread->Misses;
+	EndCritical(status);
+	return 1;
 }
 
 //******** OS_Id *************** 
@@ -291,9 +1219,49 @@ unsigned long OS_Id(void){
 	return RunPt->ID;
 }
 
+//******** OS_StackInfo *************** 
+// report the stack of one thread slot, found by scanning for the paint
+// pattern left by SetInitialStack, so the result is the peak use so far
+// Inputs: slot 0 to NUMTHREADS-1, NUMTHREADS is the idle thread
+//         pointers to where the thread ID, stack size and peak use go,
+//         sizes are in 32-bit words, overflow is set to 1 if the canary was hit
+// Outputs: 1 if the slot holds a thread, 0 if it is free,
+//          -1 if slot is past the last one
+int OS_StackInfo(unsigned long slot, unsigned long *id, unsigned long *size,
+  unsigned long *peak, unsigned long *overflow){
+	tcbType *thread;
+	uint32_t unused;
+	int32_t status;
+	if(slot > NUMTHREADS){
+		return -1;
+	}
+	thread = (slot == NUMTHREADS) ? &IdleTcb : &tcbs[slot];
+	status = StartCritical(); // the stack can not be freed while it is scanned
+	if(thread->MemStatus != USED){
+		EndCritical(status);
+		return 0;
+	}
+	unused = 0;
+	while((unused < thread->StackSize) && (thread->StackBase[unused] == STACKPAINT)){
+		unused++;
+	}
+	*id = thread->ID;
+	*size = thread->StackSize;
+	*peak = thread->StackSize - unused;
+	*overflow = thread->StackOverflow;
+	EndCritical(status);
+	return 1;
+}
+
 
 void OS_LaunchThread(void(*taskPtr)(void), int timer);
-// initializes a new thread with given period and priority
+//******** OS_AddPeriodicThread *************** 
+// add a background periodic task
+// Inputs: pointer to a void/void background function
+//         timer 0 to 23 as numbered in TIMER.c
+//         period given in system time units (12.5ns)
+//         priority 0 is the highest, 5 is the lowest
+// Outputs: 1 if successful, 0 if this thread can not be added
 int OS_AddPeriodicThread(void(*task)(void), int timer, unsigned long period, unsigned long priority)
 {// period and priority are used when initializing the timer interrupts
 	int status;
@@ -303,16 +1271,49 @@ int OS_AddPeriodicThread(void(*task)(void), int timer, unsigned long period, uns
 	// each timer should be unique to a thread so that it can interrupt when
 	// it counts to 0 and sets the flag, this requires counting timers
 	
+	if((timer == OSTIMER) || (timer == SWTIMER))
+	{ // keeps the system time or runs the software timers
+		EndCritical(sr);
+		return 0;
+	}
 	status = 0;
 	status = TIMER_TimerInit(task,timer, period, priority);
 	
 	if(status == -1)
 	{
 		//printf("Error Initializing timer number(0-11): %d\n", timer);
+		EndCritical(sr);
+		return 0;
 	}
 	OS_LaunchThread(task,timer);
 	EndCritical(sr);
-	return 0;
+	return 1;
+}
+
+//******** OS_AddPeriodicThreadRate *************** 
+// add a background periodic task that runs at num/den Hz
+// Inputs: pointer to a void/void background function
+//         timer 0 to 23 as numbered in TIMER.c
+//         rate as the fraction num/den Hz, e.g. 2000/1 or 1000/3
+//         priority 0 is the highest, 5 is the lowest
+//         where to put the achieved rate in 0.001 Hz units, can be NULL
+// Outputs: 1 if successful, 0 if this thread can not be added
+// rates that do not divide the bus clock alternate between two period
+// lengths, so the task stays phase locked to the system time over hours
+int OS_AddPeriodicThreadRate(void(*task)(void), int timer, unsigned long num,
+  unsigned long den, unsigned long priority, unsigned long *achieved)
+{
+	int sr;
+	sr = StartCritical();
+	if((timer == OSTIMER) || (timer == SWTIMER) ||
+	   (TIMER_TimerInitRate(task, timer, num, den, priority, achieved) == -1))
+	{
+		EndCritical(sr);
+		return 0;
+	}
+	OS_LaunchThread(task,timer);
+	EndCritical(sr);
+	return 1;
 }
 
 //******** OS_AddSwitchTasks *************** 
@@ -381,6 +1382,7 @@ void static DebounceSW2Task(void){
 int interrupt_count = 0;
 void GPIOPortF_Handler(void){
 	uint32_t pin;
+	TRACE_EVENT(TRACE_ISRENTER, 16+30); // exception number of GPIO Port F
 	interrupt_count++;
 	pin = GPIO_PORTF_RIS_R&0x11;   //which switch triggered the interrupt?
 	GPIO_PORTF_ICR_R |= pin;				//acknowledge
@@ -390,7 +1392,7 @@ void GPIOPortF_Handler(void){
 			(*PF4Task)();		
 		}
 		GPIO_PORTF_IM_R &= ~pin;	//disarm interrupt on PF4
-		if(OS_AddThread(&DebounceSW1Task,128,1)==0){
+		if(OS_AddThread(&DebounceSW1Task,64,1)==0){
 			GPIO_PORTF_IM_R |= pin;
 		}
 	}
@@ -399,10 +1401,11 @@ void GPIOPortF_Handler(void){
 			(*PF0Task)();
 		}
 		GPIO_PORTF_IM_R &= ~pin;	//disarm interrupt on PF0
-		if(OS_AddThread(&DebounceSW2Task,128,1)==0){
+		if(OS_AddThread(&DebounceSW2Task,64,1)==0){
 			GPIO_PORTF_IM_R |= pin;
 		}
 	}
+	TRACE_EVENT(TRACE_ISREXIT, 16+30);
 }
 //Ignore for now
 //******** OS_AddSW2Task *************** 
@@ -436,13 +1439,13 @@ void OS_Sleep(unsigned long sleepTime){
 	if(sleepTime > 0)
 	{
 		status = StartCritical();
-		RunPt->SleepCtr = sleepTime; // atomic operation
-		//g_sleepingThreads[g_numSleepingThreads++] = RunPt->ID; 
-		// store an array containing the ID's of sleeping threads
-		// this can be used to create a linked list of sleeping threads
-		//RunPt->previous->next = RunPt->next; //Link the prior thread to the next thread
-		//RunPt->next->previous = RunPt->previous;
+		ReadyList_Remove(RunPt); // SysTick puts it back when its time is up
+		SleepList_Add(RunPt, sleepTime);
+		OS_Suspend();
 		EndCritical(status);
+	}
+	else
+	{
 		OS_Suspend();
 	}
 }
@@ -456,23 +1459,16 @@ void OS_Kill(void){
 	
 	int32_t status;
 	status = StartCritical(); 
-	if(RunPt->next!= RunPt) // keep one thread running at all times
-	{		
-	//Remove the currently running thread
-		RunPt->previous->next = RunPt->next; 
-		RunPt->next->previous = RunPt->previous;
-		// remove tcb from linked list by 
-		// moving the previous nodes nextPtr
-		// to the current node's nextPtr
-		
-		RunPt->sp = NULL;
-		RunPt->MemStatus = FREE;
-		// release reference to stack pointer
-		g_NumAliveThreads--;
-		EndCritical(status);
-		OS_Suspend();
+	while(RunPt->Held != NULL){ // a dead owner would block its waiters forever
+		RunPt->Held->Count = 1;
+		OS_MutexUnlock(RunPt->Held);
 	}
-	EndCritical(status);
+	ReadyList_Remove(RunPt); // the scheduler never picks it again
+	RunPt->MemStatus = ZOMBIE; // the scheduler frees the TCB once it is off of it
+	g_NumAliveThreads--;
+	OS_Suspend();
+	EndCritical(status); // context switch happens here
+	for(;;){ }
 }
 
 // ******** OS_Suspend ************
@@ -487,31 +1483,179 @@ void OS_Suspend(void){
 	long sr = StartCritical();
 	sysreg = NVIC_SYS_HND_CTRL_R;
 	NVIC_INT_CTRL_R |= NVIC_INT_CTRL_PEND_SV; // does a contex switch 
-	OS_ClearMsTime(); // reset SysTick period
 	EndCritical(sr);
 }
  
+// ******** OS_FifoInit ************
+// make an empty single producer single consumer Fifo in caller storage
+// the put index is only written by the producer and the get index only by
+// the consumer, so neither side locks, both indices run freely and are
+// masked and PutI-GetI is the number of elements
+// Inputs: pointer to the Fifo, buffer of capacity*elementSize bytes,
+//         bytes per element, capacity a power of 2 and at least 2
+// Outputs: 1 if successful, 0 if capacity is not a power of 2
+int OS_FifoInit(OSFifoType *fifo, void *buffer,
+  unsigned long elementSize, unsigned long capacity){
+	if((capacity < 2) || (capacity&(capacity-1)) || (elementSize == 0)){
+		return 0;
+	}
+	fifo->Buffer = (uint8_t *)buffer;
+	fifo->ElementSize = elementSize;
+	fifo->Mask = capacity-1;
+	fifo->PutI = 0;
+	fifo->GetI = 0;
+	fifo->Want = 0;
+	OS_InitSemaphore(&fifo->Ready, 0);
+	return 1;
+}
+
+// ******** Fifo_Published ************
+// called by the producer after moving the put index,
+// wakes the consumer once the number of elements reaches what it waits for
+// this relies on the one producer not being interrupted by the consumer
+void static Fifo_Published(OSFifoType *fifo, uint32_t putI){
+	uint32_t want = fifo->Want;
+	if((want != 0) && (putI - fifo->GetI >= want)){
+		fifo->Want = 0;
+		OS_bSignal(&fifo->Ready);
+	}
+}
+
+// ******** Fifo_Await ************
+// called by the consumer, blocks until at least n elements are in the Fifo
+void static Fifo_Await(OSFifoType *fifo, uint32_t getI, uint32_t n){
+	while(fifo->PutI - getI < n){
+		fifo->Want = n;
+		if(fifo->PutI - getI >= n){ // a put got in before the producer could see Want
+			fifo->Want = 0;
+			break;
+		}
+		OS_bWait(&fifo->Ready);   // a leftover signal just goes around the loop again
+	}
+	DMB();                        // read the data only after seeing the put index
+}
+
+// ******** Fifo_Copy ************
+// copy n elements between a Fifo and a flat buffer, starting at index i
+// of the Fifo, in two pieces if they wrap past the end of its storage
+void static Fifo_Copy(OSFifoType *fifo, uint32_t i, uint8_t *buf, uint32_t n, int toFifo){
+	uint32_t es = fifo->ElementSize;
+	uint32_t start = i&fifo->Mask;
+	uint32_t first = fifo->Mask + 1 - start; // elements before the end of the storage
+	if(first > n){
+		first = n;
+	}
+	if(toFifo){
+		memcpy(&fifo->Buffer[start*es], buf, first*es);
+		memcpy(fifo->Buffer, &buf[first*es], (n-first)*es);
+	}else{
+		memcpy(buf, &fifo->Buffer[start*es], first*es);
+		memcpy(&buf[first*es], fifo->Buffer, (n-first)*es);
+	}
+}
+
+// ******** OS_FifoPut ************
+// enter one element into a Fifo, the producer side
+// Inputs:  pointer to the Fifo, pointer to the element
+// Outputs: 1 if it was saved, 0 if the Fifo was full
+// does not wait, so it can be called from interrupt handlers
+int OS_FifoPut(OSFifoType *fifo, const void *element){
+	uint32_t putI = fifo->PutI;
+	if(putI - fifo->GetI > fifo->Mask){ // full, the element is lost
+		return FIFO_FAIL;
+	}
+	if(fifo->ElementSize == sizeof(uint32_t)){
+		((uint32_t *)fifo->Buffer)[putI&fifo->Mask] = *(const uint32_t *)element;
+	}else{
+		memcpy(&fifo->Buffer[(putI&fifo->Mask)*fifo->ElementSize], element, fifo->ElementSize);
+	}
+	DMB();                 // the data is in place before the consumer can see it
+	fifo->PutI = putI + 1;
+	Fifo_Published(fifo, putI + 1);
+	TRACE_EVENT(TRACE_FIFOPUT, putI + 1 - fifo->GetI);
+	return FIFO_SUCCESS;
+}
+
+// ******** OS_FifoPutBlock ************
+// enter n elements into a Fifo, all of them or none, the producer side
+// Inputs:  pointer to the Fifo, pointer to the elements, number of elements
+// Outputs: 1 if they were saved, 0 if there was not room for all of them
+// does not wait, so it can be called from interrupt handlers
+int OS_FifoPutBlock(OSFifoType *fifo, const void *elements, unsigned long n){
+	uint32_t putI = fifo->PutI;
+	if(n > fifo->Mask + 1 - (putI - fifo->GetI)){
+		return FIFO_FAIL;
+	}
+	Fifo_Copy(fifo, putI, (uint8_t *)elements, n, 1);
+	DMB();
+	fifo->PutI = putI + n;
+	Fifo_Published(fifo, putI + n);
+	TRACE_EVENT(TRACE_FIFOPUT, putI + n - fifo->GetI);
+	return FIFO_SUCCESS;
+}
+
+// ******** OS_FifoGet ************
+// remove one element from a Fifo, the consumer side, blocks if empty
+// Inputs:  pointer to the Fifo, where the element goes
+// Outputs: none
+// only one thread may get from a Fifo
+void OS_FifoGet(OSFifoType *fifo, void *element){
+	uint32_t getI = fifo->GetI;
+	Fifo_Await(fifo, getI, 1);
+	if(fifo->ElementSize == sizeof(uint32_t)){
+		*(uint32_t *)element = ((uint32_t *)fifo->Buffer)[getI&fifo->Mask];
+	}else{
+		memcpy(element, &fifo->Buffer[(getI&fifo->Mask)*fifo->ElementSize], fifo->ElementSize);
+	}
+	DMB();                 // done with the slot before the producer can reuse it
+	fifo->GetI = getI + 1;
+	TRACE_EVENT(TRACE_FIFOGET, fifo->PutI - (getI + 1));
+}
+
+// ******** OS_FifoGetBlock ************
+// remove n elements from a Fifo, the consumer side,
+// blocks once until all n are there
+// Inputs:  pointer to the Fifo, where the elements go, number of elements
+// Outputs: n, 0 if n is more than the Fifo can hold
+// only one thread may get from a Fifo
+unsigned long OS_FifoGetBlock(OSFifoType *fifo, void *elements, unsigned long n){
+	uint32_t getI = fifo->GetI;
+	if(n > fifo->Mask + 1){ // would wait forever
+		return 0;
+	}
+	Fifo_Await(fifo, getI, n);
+	Fifo_Copy(fifo, getI, (uint8_t *)elements, n, 0);
+	DMB();
+	fifo->GetI = getI + n;
+	TRACE_EVENT(TRACE_FIFOGET, fifo->PutI - (getI + n));
+	return n;
+}
+
+// ******** OS_FifoSize ************
+// number of elements in a Fifo
+// Inputs:  pointer to the Fifo
+// Outputs: greater than zero if a get will return right away,
+//          zero if the Fifo is empty and a get will block
+long OS_FifoSize(OSFifoType *fifo){
+	return fifo->PutI - fifo->GetI;
+}
+
 // ******** OS_Fifo_Init ************
 // Initialize the Fifo to be empty
-// Inputs: size
+// Inputs: size, rounded down to a power of 2 from 2 to 128 elements
 // Outputs: none 
-// In Lab 2, you can ignore the size field
-// In Lab 3, you should implement the user-defined fifo size
-// In Lab 3, you can put whatever restrictions you want on size
-//    e.g., 4 to 64 elements
-//    e.g., must be a power of 2,4,8,16,32,64,128
 void OS_Fifo_Init(unsigned long size)
 {
-	g_FIFOSIZE = size;
-	// does this need to be protected???
-	// will it only be called at the beginning
-	g_Fifo = &Fifo[0];
-	g_fifoPutPtr = &g_Fifo[0];
-	g_fifoGetPtr = &g_Fifo[0];
-	
-	g_roomLeft.Value = g_FIFOSIZE;
-	g_dataAvailable.Value = 0;
-	g_fifoMutex.Value = 1; 
+	uint32_t n = 2;
+	if(size > FIFOMAXSIZE)
+	{
+		size = FIFOMAXSIZE;
+	}
+	while(2*n <= size)
+	{
+		n = 2*n;
+	}
+	OS_FifoInit(&OSFifo, Fifo, sizeof(Fifo[0]), n);
 }
 
 // ******** OS_Fifo_Put ************
@@ -524,71 +1668,53 @@ void OS_Fifo_Init(unsigned long size)
 //  this function can not disable or enable interrupts
 int OS_Fifo_Put(unsigned long data)
 {
-	int32_t status;
-	unsigned long* nextPutPtr;
-	nextPutPtr = g_fifoPutPtr + 1;
-	
-//	OS_Wait(&g_roomLeft);
-//	OS_bWait(&g_fifoMutex); 
-	
-	if(nextPutPtr == &g_Fifo[g_FIFOSIZE])
-	{ //wrap
-		nextPutPtr = &g_Fifo[0];
-	}
-	if(nextPutPtr == g_fifoGetPtr)
-	{ // check for full FIFO
-		// You DON'T want to call OS_Signal(&g_dataAvailable 
-		// if you didn't add more data to the fifo 
-		status = FIFO_FAIL;
-		OS_bSignal(&g_fifoMutex); // release lock on g_fifoPutPtr
-	}
-	else
-	{ // only add data and update pointer if room left
-		
-		status = FIFO_SUCCESS;
-		*(g_fifoPutPtr) = data; // store data at current index
-		g_fifoPutPtr = nextPutPtr; // update PutPtr
-		OS_bSignal(&g_fifoMutex); // release lock on g_fifoPutPtr
-		OS_Signal(&g_dataAvailable); // signal you added data to the fifo and its ready to be read
-	}
-	return status;
-
+	return OS_FifoPut(&OSFifo, &data);
 } 
 
+// ******** OS_Fifo_PutBlock ************
+// Enter n data samples into the Fifo, all of them or none
+// Called from the background, so no waiting 
+// Inputs:  pointer to the samples, number of samples
+// Outputs: true if the data is properly saved,
+//          false if nothing was saved, because there was not room for all of it
+int OS_Fifo_PutBlock(const unsigned long *buf, unsigned long n)
+{
+	return OS_FifoPutBlock(&OSFifo, buf, n);
+}
+
 // ******** OS_Fifo_Get ************
 // Remove one data sample from the Fifo
-// Called in foreground, will spin/block if empty
+// Called in foreground, will block if empty
 // Inputs:  none
 // Outputs: data 
+// only one thread may call this
 unsigned long OS_Fifo_Get(void)
 {
 	unsigned long data;
-	
-	OS_Wait(&g_dataAvailable); // make sure there is no underflow & there is an element in the fifo to get
-	OS_bWait(&g_fifoMutex); // lock out the g_fifoGetPtr from all other threads
-	data = *(g_fifoGetPtr++); // get the data, then move to next index in fifo
-	
-	if(g_fifoGetPtr == &g_Fifo[g_FIFOSIZE])
-	{ // wrap
-		g_fifoGetPtr = &g_Fifo[0];
-	}
-	
-	OS_bSignal(&g_fifoMutex); // release lock on g_fifoGetPtr
-	OS_Signal(&g_roomLeft);
-	
+	OS_FifoGet(&OSFifo, &data);
 	return data;
 }
 
+// ******** OS_Fifo_GetBlock ************
+// Remove n data samples from the Fifo
+// Called in foreground, blocks once until all n are there
+// Inputs:  pointer to where the samples go, number of samples
+// Outputs: n, 0 if n is more than the Fifo can hold
+// only one thread may call this
+unsigned long OS_Fifo_GetBlock(unsigned long *buf, unsigned long n)
+{
+	return OS_FifoGetBlock(&OSFifo, buf, n);
+}
+
 // ******** OS_Fifo_Size ************
 // Check the status of the Fifo
 // Inputs: none
 // Outputs: returns the number of elements in the Fifo
 //          greater than zero if a call to OS_Fifo_Get will return right away
-//          zero or less than zero if the Fifo is empty 
-//          zero or less than zero if a call to OS_Fifo_Get will spin or block
+//          zero if the Fifo is empty and a call to OS_Fifo_Get will block
 long OS_Fifo_Size(void)
 {
-	return g_roomLeft.Value;
+	return OS_FifoSize(&OSFifo);
 }
 
 // DA 2/20
@@ -602,8 +1728,8 @@ void OS_MailBox_Init(void)
 	int32_t status;
 	status = StartCritical();
 	g_mailboxData = 0;
-	g_mailboxFree.Value = MAILBOX_EMPTY; // valid data can be put into mailbox
-	g_mailboxDataValid.Value = DATA_NOT_VALID; //valid data hasn't been put into mailbox yet
+	OS_InitSemaphore(&g_mailboxFree, MAILBOX_EMPTY); // valid data can be put into mailbox
+	OS_InitSemaphore(&g_mailboxDataValid, DATA_NOT_VALID); //valid data hasn't been put into mailbox yet
 	EndCritical(status);
 }
 
@@ -639,35 +1765,332 @@ unsigned long OS_MailBox_Recv(void)
 	return data;
 }
 
+// ******** OS_QueueInit ************
+// make an empty message queue in caller storage
+// Inputs: pointer to the queue, buffer of depth*msgSize bytes,
+//         bytes per message, number of messages it holds
+// Outputs: 1 if successful, 0 if depth or msgSize is zero
+// any number of threads may send and receive
+int OS_QueueInit(OSQueueType *queue, void *buffer,
+  unsigned long msgSize, unsigned long depth){
+	if((depth == 0) || (msgSize == 0)){
+		return 0;
+	}
+	queue->Buffer = (uint8_t *)buffer;
+	queue->MsgSize = msgSize;
+	queue->Depth = depth;
+	queue->PutI = 0;
+	queue->GetI = 0;
+	OS_InitSemaphore(&queue->Messages, 0);
+	OS_InitSemaphore(&queue->Room, depth);
+	return 1;
+}
+
+// ******** Queue_Put ************
+// copy a message in, the caller already holds a unit of Room
+void static Queue_Put(OSQueueType *queue, const void *msg){
+	int32_t status;
+	status = StartCritical(); // several senders may be copying
+	memcpy(&queue->Buffer[queue->PutI*queue->MsgSize], msg, queue->MsgSize);
+	queue->PutI++;
+	if(queue->PutI == queue->Depth){
+		queue->PutI = 0;
+	}
+	EndCritical(status);
+	OS_Signal(&queue->Messages);
+}
+
+// ******** Queue_Get ************
+// copy a message out, the caller already holds a unit of Messages
+void static Queue_Get(OSQueueType *queue, void *msg){
+	int32_t status;
+	status = StartCritical();
+	memcpy(msg, &queue->Buffer[queue->GetI*queue->MsgSize], queue->MsgSize);
+	queue->GetI++;
+	if(queue->GetI == queue->Depth){
+		queue->GetI = 0;
+	}
+	EndCritical(status);
+	OS_Signal(&queue->Room);
+}
+
+// ******** OS_QueueSend ************
+// enter a message into the queue, blocks while the queue is full
+// Inputs:  pointer to the queue, pointer to the message
+// Outputs: none
+void OS_QueueSend(OSQueueType *queue, const void *msg){
+	OS_Wait(&queue->Room);
+	Queue_Put(queue, msg);
+}
+
+// ******** OS_QueueTrySend ************
+// enter a message into the queue only if there is room
+// Inputs:  pointer to the queue, pointer to the message
+// Outputs: 1 if sent, 0 if the queue was full
+// can be called from interrupt handlers
+int OS_QueueTrySend(OSQueueType *queue, const void *msg){
+	return OS_QueueSendTimeout(queue, msg, 0);
+}
+
+// ******** OS_QueueSendTimeout ************
+// enter a message into the queue, waiting at most timeout ms for room
+// Inputs:  pointer to the queue, pointer to the message, ms to wait
+// Outputs: 1 if sent, 0 if the time ran out
+int OS_QueueSendTimeout(OSQueueType *queue, const void *msg, unsigned long timeout){
+	if(OS_WaitTimeout(&queue->Room, timeout) == 0){
+		return 0;
+	}
+	Queue_Put(queue, msg);
+	return 1;
+}
+
+// ******** OS_QueueRecv ************
+// remove the oldest message from the queue, blocks while it is empty
+// Inputs:  pointer to the queue, where the message goes
+// Outputs: none
+void OS_QueueRecv(OSQueueType *queue, void *msg){
+	OS_Wait(&queue->Messages);
+	Queue_Get(queue, msg);
+}
+
+// ******** OS_QueueTryRecv ************
+// remove the oldest message only if there is one
+// Inputs:  pointer to the queue, where the message goes
+// Outputs: 1 if a message was received, 0 if the queue was empty
+// can be called from interrupt handlers
+int OS_QueueTryRecv(OSQueueType *queue, void *msg){
+	return OS_QueueRecvTimeout(queue, msg, 0);
+}
+
+// ******** OS_QueueRecvTimeout ************
+// remove the oldest message, waiting at most timeout ms for one
+// Inputs:  pointer to the queue, where the message goes, ms to wait
+// Outputs: 1 if a message was received, 0 if the time ran out
+int OS_QueueRecvTimeout(OSQueueType *queue, void *msg, unsigned long timeout){
+	if(OS_WaitTimeout(&queue->Messages, timeout) == 0){
+		return 0;
+	}
+	Queue_Get(queue, msg);
+	return 1;
+}
+
+// ******** OS_TimeOverflow ************
+// runs in Timer1A_Handler each time the lower 32 bits of the system time wrap
+// the timeout is already acknowledged, Timer1A is priority 0 so no interrupt
+// can read the time before g_timeHigh catches up
+void OS_TimeOverflow(void)
+{
+	g_timeHigh++;
+}
+
 // ******** OS_Time ************
-// return the system time using SysTick
+// return the lower 32 bits of the system time
 // Inputs:  none
-// Outputs: time in 12.5ns units, 0 to 2^24-1
-// The time resolution should be less than or equal to 1us, and the precision 32 bits
-// It is ok to change the resolution and precision of this function as long as 
-//   this function and OS_TimeDifference have the same resolution and precision 
+// Outputs: time in 12.5ns units, 0 to 4294967295, counts up and wraps every 53.7 s
 unsigned long OS_Time(void)
 {
-	// assumes an 80 MHz Clock
-	return TIMER1_TAR_R;
+	return ~TIMER1_TAR_R; // the timer counts down from 0xFFFFFFFF
+}
+
+// ******** OS_Time64 ************
+// return the system time since OS_Init, never wraps
+// Inputs:  none
+// Outputs: time in 12.5ns units
+// can be called with interrupts disabled, a wrap that is not counted yet
+// is seen in the raw interrupt status
+unsigned long long OS_Time64(void)
+{
+	uint32_t high, low;
+	int32_t status;
+	status = StartCritical();
+	high = g_timeHigh;
+	low = ~TIMER1_TAR_R;
+	if(TIMER1_RIS_R&TIMER_RIS_TATORIS)
+	{ // wrapped, but OS_TimeOverflow has not run yet
+		high++;
+		low = ~TIMER1_TAR_R; // read again, the first read may be from before the wrap
+	}
+	EndCritical(status);
+	return ((unsigned long long)high<<32)|low;
 }
 
 // DA 2/22
 // ******** OS_TimeDifference ************
 // Calculates difference between two times
-// Inputs:  two times measured with OS_Time
+// Inputs:  two times measured with OS_Time, start first
 // Outputs: time difference in 12.5ns units 
-// The time resolution should be less than or equal to 1us, and the precision at least 12 bits
-// It is ok to change the resolution and precision of this function as long as 
-// this function and OS_Time have the same resolution and precision 
+// correct across a wrap as long as the two are less than 53.7 s apart
 unsigned long OS_TimeDifference(unsigned long start, unsigned long stop)
 {
-	// NOTE: This cannot accurately account for time differences
-	// when you roll over. Requires: start > end & that both have been
-	// read within the same SysTick Period
-	unsigned long diff;
-	diff = (start - stop);
-	return diff;
+	return stop - start; // modulo 2^32
+}
+
+// ******** OS_TimeToUs ************
+// convert a system time or time difference to microseconds
+// Inputs:  time in 12.5ns units
+// Outputs: time in us
+unsigned long long OS_TimeToUs(unsigned long long time)
+{
+	return time/(TIME_1MS/1000);
+}
+
+// ******** OS_TimeToMs ************
+// convert a system time or time difference to milliseconds
+// Inputs:  time in 12.5ns units
+// Outputs: time in ms
+unsigned long long OS_TimeToMs(unsigned long long time)
+{
+	return time/TIME_1MS;
+}
+
+// ******** TimerHeap_Place ************
+// put a timer in heap slot i
+void static TimerHeap_Place(OSTimerType *timer, uint32_t i){
+	TimerHeap[i] = timer;
+	timer->Index = i;
+}
+
+// ******** TimerHeap_Fix ************
+// move the timer in slot i up or down until the heap is in order again
+// must be called with interrupts disabled
+void static TimerHeap_Fix(uint32_t i){
+	OSTimerType *timer = TimerHeap[i];
+	uint32_t child;
+	while((i > 0) && (timer->Expire < TimerHeap[(i-1)/2]->Expire)){ // earlier than its parent
+		TimerHeap_Place(TimerHeap[(i-1)/2], i);
+		i = (i-1)/2;
+	}
+	for(;;){
+		child = 2*i+1;
+		if(child >= g_numTimers){
+			break;
+		}
+		if((child+1 < g_numTimers) && (TimerHeap[child+1]->Expire < TimerHeap[child]->Expire)){
+			child++;
+		}
+		if(TimerHeap[child]->Expire >= timer->Expire){
+			break;
+		}
+		TimerHeap_Place(TimerHeap[child], i);
+		i = child;
+	}
+	TimerHeap_Place(timer, i);
+}
+
+// ******** TimerHeap_Remove ************
+// take a running timer out of the heap
+// must be called with interrupts disabled
+void static TimerHeap_Remove(OSTimerType *timer){
+	uint32_t i = timer->Index;
+	timer->Index = -1;
+	g_numTimers--;
+	if(i < g_numTimers){ // the last one fills the hole
+		TimerHeap_Place(TimerHeap[g_numTimers], i);
+		TimerHeap_Fix(i);
+	}
+}
+
+// ******** SWTimer_Program ************
+// set the hardware one-shot for the earliest software timer
+// must be called with interrupts disabled
+void static SWTimer_Program(void){
+	long long delta;
+	TIMER5_CTL_R &= ~TIMER_CTL_TAEN;
+	if(g_numTimers == 0){
+		return;
+	}
+	delta = (long long)(TimerHeap[0]->Expire - OS_Time64());
+	if(delta < SWTIMERMIN){ // due already
+		delta = SWTIMERMIN;
+	}else if(delta > 0xFFFFFFFF){ // wakes up early and sets it again
+		delta = 0xFFFFFFFF;
+	}
+	TIMER5_TAILR_R = delta-1;
+	TIMER5_CTL_R |= TIMER_CTL_TAEN;
+}
+
+// ******** SWTimer_Handler ************
+// runs in Timer5A_Handler, calls every timer that is due and sets up the next one
+// only timers that were due on entry run, so a short period can not lock it up
+// the heap is shared with OS_SWTimerStart and OS_SWTimerCancel in higher
+// priority interrupts, so every heap step is a critical section, the
+// timer tasks run with interrupts enabled
+void static SWTimer_Handler(void){
+	OSTimerType *timer;
+	int32_t status;
+	unsigned long long now = OS_Time64();
+	for(;;){
+		status = StartCritical();
+		if((g_numTimers == 0) || (TimerHeap[0]->Expire > now)){
+			break; // still in the critical section for SWTimer_Program
+		}
+		timer = TimerHeap[0];
+		if(timer->Period != 0){ // periodic, stays in the heap
+			timer->Expire += timer->Period;
+			if(timer->Expire <= now){ // overran, skip the periods that were missed
+				timer->Expire = now + timer->Period;
+			}
+			TimerHeap_Fix(0);
+		}else{
+			TimerHeap_Remove(timer);
+		}
+		EndCritical(status);
+		(*timer->Task)();  // may start or cancel timers
+	}
+	SWTimer_Program();
+	EndCritical(status);
+}
+
+// ******** OS_SWTimerInit ************
+// set up a software timer, it does not run until OS_SWTimerStart
+// Inputs:  pointer to the timer, function to call when it expires
+// Outputs: none
+void OS_SWTimerInit(OSTimerType *timer, void(*task)(void)){
+	timer->Task = task;
+	timer->Period = 0;
+	timer->Index = -1;
+}
+
+// ******** OS_SWTimerStart ************
+// start or reschedule a software timer
+// Inputs:  pointer to the timer, 12.5ns units until it first expires,
+//          12.5ns units between expirations after that, 0 for a one-shot
+// Outputs: 1 if successful, 0 if MAXSWTIMERS are running already
+// the function runs in the Timer5A interrupt, so it can not block or sleep
+int OS_SWTimerStart(OSTimerType *timer, unsigned long delay, unsigned long period){
+	int32_t status;
+	status = StartCritical();
+	if(timer->Index >= 0){ // running, move it instead
+		TimerHeap_Remove(timer);
+	}
+	if(g_numTimers == MAXSWTIMERS){
+		EndCritical(status);
+		return 0;
+	}
+	timer->Expire = OS_Time64() + delay;
+	timer->Period = period;
+	TimerHeap_Place(timer, g_numTimers);
+	g_numTimers++;
+	TimerHeap_Fix(timer->Index);
+	if(timer->Index == 0){ // earliest now
+		SWTimer_Program();
+	}
+	EndCritical(status);
+	return 1;
+}
+
+// ******** OS_SWTimerCancel ************
+// stop a software timer, nothing happens if it is not running
+// Inputs:  pointer to the timer
+// Outputs: none
+void OS_SWTimerCancel(OSTimerType *timer){
+	int32_t status;
+	status = StartCritical();
+	if(timer->Index >= 0){
+		TimerHeap_Remove(timer);
+		SWTimer_Program(); // it may have been the earliest
+	}
+	EndCritical(status);
 }
 
 // DA 2/22
@@ -712,12 +2135,19 @@ unsigned long OS_MsTime(void)
 // In Lab 3, you should implement the user-defined TimeSlice field
 // It is ok to limit the range of theTimeSlice to match the 24-bit SysTick
 void OS_Launch(unsigned long theTimeSlice){
-	//RunPt = &tcbs[0];       // thread 0 will run first    This is done in OS_AddThread
 	#ifdef SYSTICK
+	g_timeSlice = theTimeSlice;
 	NVIC_ST_CURRENT_R = 0;      // any write to current clears it
 	NVIC_ST_RELOAD_R = theTimeSlice - 1; // reload value
   NVIC_ST_CTRL_R = NVIC_ST_CTRL_ENABLE+NVIC_ST_CTRL_CLK_SRC+NVIC_ST_CTRL_INTEN;// enable, core clock and interrupt arm
 	#endif
+	RunPt = &IdleTcb;
+#ifdef PROFILE
+	g_chargeTime = g_snapshotTime = OS_Time();
+	OS_SWTimerInit(&CpuTimer, &Cpu_Snapshot);
+	OS_SWTimerStart(&CpuTimer, CPUSNAPSHOT, CPUSNAPSHOT);
+#endif
+	Scheduler();                 // RunPt = highest priority thread
   StartOS();                   // start on the first task
 }
 
@@ -762,35 +2192,19 @@ void OS_NVIC_DisableTimerInt(int timer)
 // the function ptr isn't necessary here for the periodic threads
 void OS_LaunchThread(void(*taskPtr)(void), int timer)
 {
-	int timerN;
-	unsigned int TAEN_TBEN;
-
-	timerN = timer; // its the timerID (0 to 11)
-	OS_NVIC_EnableTimerInt(timer);
-	TAEN_TBEN = ((timerN%2) ? TIMER_CTL_TBEN : TIMER_CTL_TAEN); // if timerN even => TAEN, timerN odd => TBEN
-	*(timerCtrlBuf[timerN]) |= TAEN_TBEN; // start timer for this thread, X in {0,1,2,3,4,5}, x in {A,B}
-	// ^^^ is *(TIMERX_CTRL_PTR_R) |= TIMER_CTL_TxEN and/or TIMERX_CTL_R |= TIMER_CTL_TxEN
-	//(*taskPtr)(); // begin task for this thread Do this in the ISR
+	TIMER_Start(timer); // the task runs in the ISR
 }
 
 // disable periodic timer interrupt 
 void OS_StopThread(void(*taskPtr)(void), int timer)
 {
-	int timerN;
-	unsigned int TAEN_TBEN;
-
-	timerN = timer; // its the timerID (0 to 11)
-	OS_NVIC_DisableTimerInt(timer);
-	TAEN_TBEN = ((timerN%2) ? TIMER_CTL_TBEN : TIMER_CTL_TAEN); // if timerN even => TAEN, timerN odd => TBEN
-	*(timerCtrlBuf[timerN]) &= ~TAEN_TBEN; // start timer for this thread, X in {0,1,2,3,4,5}, x in {A,B}
-	// ^^^ is *(TIMERX_CTRL_PTR_R) |= TIMER_CTL_TxEN and/or TIMERX_CTL_R |= TIMER_CTL_TxEN
-	//(*taskPtr)(); // begin task for this thread Do this in the ISR
+	TIMER_Stop(timer);
 }
 
-// this configures the timers for 32-bit mode, periodic mode
-int OS_TimerInit(void(*task)(void), int timer, unsigned long desiredFrequency, unsigned long priority)
+// this configures the timers for periodic mode, period in 12.5ns units
+int OS_TimerInit(void(*task)(void), int timer, unsigned long period, unsigned long priority)
 {
-	TIMER_TimerInit(task,timer,desiredFrequency,priority);
+	TIMER_TimerInit(task,timer,period,priority);
 	return 0;
 }
 
@@ -830,32 +2244,330 @@ void PF3_Toggle(void)
 		GPIO_PORTF_DATA_R ^= 0x08;
 }
 
+#ifdef PROFILE
+#define PROFILEBIN0 64     // bus cycles, bin 0 is under 0.8us, each next bin is twice as wide
+static OSTaskProfileType Profile[TIMER_NUMTIMERS];
+
+// log2 histogram bin of a time in bus cycles
+static __inline unsigned long ProfileBin(unsigned long cycles){
+	unsigned long bin;
+	if(cycles < PROFILEBIN0){
+		return 0;
+	}
+	bin = 32-CLZ(cycles/PROFILEBIN0);
+	return (bin < OS_PROFILEBINS) ? bin : OS_PROFILEBINS-1;
+}
+
+//******** OS_ProfileTask *************** 
+// record one call of a timer task, called by the timer dispatcher
+// each task only runs in its own interrupt, so its statistics need no
+// critical section, g_isrTime is shared with every timer task and SysTick
+// Inputs: task is the timer 0 to 23 as numbered in TIMER.c
+//         latency is bus cycles from the timer timeout to the task call,
+//           OS_NOLATENCY if it can not be told
+//         exec is bus cycles the task ran, including any interrupts
+//         isrStart is OS_IsrTime when the task was called
+// Outputs: none
+void OS_ProfileTask(int task, unsigned long latency, unsigned long exec,
+  unsigned long isrStart){
+	OSTaskProfileType *p = &Profile[task];
+	unsigned long nested;
+	int32_t status;
+	if(latency != OS_NOLATENCY){
+		if(p->LatencyCount == 0){
+			p->LatencyMin = p->LatencyMax = latency;
+		}
+		if(latency < p->LatencyMin) p->LatencyMin = latency;
+		if(latency > p->LatencyMax) p->LatencyMax = latency;
+		p->LatencySum += latency;
+		p->LatencyHist[ProfileBin(latency)]++;
+		p->LatencyCount++;
+	}
+	if(p->Count == 0){
+		p->ExecMin = p->ExecMax = exec;
+	}
+	if(exec < p->ExecMin) p->ExecMin = exec;
+	if(exec > p->ExecMax) p->ExecMax = exec;
+	p->ExecSum += exec;
+	p->ExecHist[ProfileBin(exec)]++;
+	p->Count++;
+	status = StartCritical();
+	nested = g_isrTime - isrStart; // timer tasks and SysTick that interrupted this one
+	if(nested < exec){
+		g_isrTime += exec - nested;  // only its own time, the nested ones added theirs
+	}
+	EndCritical(status);
+}
+
+//******** OS_IsrTime *************** 
+// free running count of bus cycles spent in timer tasks and SysTick
+// Inputs: none
+// Outputs: bus cycles, wraps around
+unsigned long OS_IsrTime(void){
+	return g_isrTime;
+}
+
+//******** OS_TaskProfile *************** 
+// copy the latency and run time statistics of one timer task
+// Inputs: task is the timer 0 to 23 as numbered in TIMER.c
+//         where to put the statistics
+// Outputs: 1 if the task has run since the last OS_ProfileReset, 0 if not,
+//          -1 if task is past the last timer
+int OS_TaskProfile(int task, OSTaskProfileType *profile){
+	int32_t status;
+	if((task < 0) || (task >= TIMER_NUMTIMERS)){
+		return -1;
+	}
+	status = StartCritical(); // a consistent snapshot
+	*profile = Profile[task];
+	EndCritical(status);
+	return (profile->Count != 0);
+}
+
+//******** OS_ProfileReset *************** 
+// clear the statistics of every timer task
+// Inputs: none
+// Outputs: none
+void OS_ProfileReset(void){
+	int32_t status = StartCritical();
+	memset(Profile, 0, sizeof(Profile));
+	EndCritical(status);
+}
+
+// prints a time in bus cycles as us with one decimal
+static void PrintUs(unsigned long cycles){
+	cycles = (cycles+4)/8; // 0.1us
+	printf("%5lu.%lu", cycles/10, cycles%10);
+}
+
+//******** Jitter *************** 
+// print the latency and run time of every timer task that has run, in us,
+// and their histograms, bin 0 is under 0.8us and each next bin doubles
+// a one-shot timer shows dashes for its latency
+// Inputs: none
+// Outputs: none
+void Jitter(void){
+	OSTaskProfileType p;
+	int task, bin;
+	printf("\n\rtimer  count   lat min   mean    max  exec min   mean    max");
+	for(task = 0; OS_TaskProfile(task, &p) >= 0; task++){
+		if(p.Count == 0){
+			continue;
+		}
+		printf("\n\r%-5d %6lu  ", task, p.Count);
+		if(p.LatencyCount != 0){
+			PrintUs(p.LatencyMin); PrintUs(p.LatencySum/p.LatencyCount); PrintUs(p.LatencyMax);
+		}else{
+			printf("%7s%7s%7s", "-", "-", "-");
+		}
+		printf("  ");
+		PrintUs(p.ExecMin); PrintUs(p.ExecSum/p.Count); PrintUs(p.ExecMax);
+		printf("\n\r   lat ");
+		for(bin = 0; bin < OS_PROFILEBINS; bin++){
+			printf(" %lu", p.LatencyHist[bin]);
+		}
+		printf("\n\r   exec");
+		for(bin = 0; bin < OS_PROFILEBINS; bin++){
+			printf(" %lu", p.ExecHist[bin]);
+		}
+	}
+}
+
+// the share of a snapshot window, in 0.1% units, that delta took
+static __inline uint32_t Cpu_Percent(unsigned long long delta, uint32_t window){
+	if(delta >= window){
+		return 1000;
+	}
+	if(window < 1000){
+		return 0;
+	}
+	return (uint32_t)delta/(window/1000); // 32-bit divide, delta*1000 would not fit
+}
+
+// ******** Cpu_Snapshot ************
+// recompute the utilization of every thread, timer task and SysTick over
+// the time since the last snapshot, runs every CPUSNAPSHOT in the
+// software timer interrupt, about 10us with interrupts disabled
+void static Cpu_Snapshot(void){
+	uint32_t now, window;
+	unsigned long long total;
+	tcbType *thread;
+	int32_t status;
+	int i;
+	status = StartCritical();
+	now = OS_Time();
+	window = now - g_snapshotTime;
+	g_snapshotTime = now;
+	Cpu_Charge(now);  // the running thread is charged up to now
+	for(i = 0; i <= NUMTHREADS; i++){
+		thread = (i == NUMTHREADS) ? &IdleTcb : &tcbs[i];
+		thread->Percent = Cpu_Percent(thread->RunTime - thread->RunLast, window);
+		thread->RunLast = thread->RunTime;
+	}
+	for(i = 0; i < CPUISRS; i++){
+		total = (i == TIMER_NUMTIMERS) ? SysTickTotal : Profile[i].ExecSum;
+		if(total < IsrLast[i]){ // OS_ProfileReset cleared it
+			IsrLast[i] = 0;
+		}
+		IsrPercent[i] = Cpu_Percent(total - IsrLast[i], window);
+		IsrLast[i] = total;
+	}
+	EndCritical(status);
+}
+
+//******** OS_CpuInfo *************** 
+// report the CPU use of one thread slot
+// Inputs: slot 0 to NUMTHREADS-1, NUMTHREADS is the idle thread
+//         pointers to where the thread ID, its share of the CPU over the
+//         last second in 0.1% units, and the bus cycles it has run go
+// Outputs: 1 if the slot holds a thread, 0 if it is free,
+//          -1 if slot is past the last one
+// time spent in timer tasks and SysTick is not charged to the threads
+int OS_CpuInfo(unsigned long slot, unsigned long *id, unsigned long *percent,
+  unsigned long long *total){
+	tcbType *thread;
+	int32_t status;
+	if(slot > NUMTHREADS){
+		return -1;
+	}
+	thread = (slot == NUMTHREADS) ? &IdleTcb : &tcbs[slot];
+	status = StartCritical();
+	if((slot < NUMTHREADS) && (thread->MemStatus != USED)){
+		EndCritical(status);
+		return 0;
+	}
+	if(thread == RunPt){
+		Cpu_Charge(OS_Time()); // include the time since it was switched in
+	}
+	*id = thread->ID;
+	*percent = thread->Percent;
+	*total = thread->RunTime;
+	EndCritical(status);
+	return 1;
+}
+
+//******** OS_IsrCpuInfo *************** 
+// report the CPU use of one timer task or SysTick
+// Inputs: task is the timer 0 to 23 as numbered in TIMER.c, OS_SYSTICKTASK
+//         is SysTick_Handler
+//         pointers to where its share of the CPU over the last second in
+//         0.1% units and the bus cycles it has run go
+// Outputs: 1 if it has run since the last OS_ProfileReset, 0 if not,
+//          -1 if task is past the last one
+int OS_IsrCpuInfo(int task, unsigned long *percent, unsigned long long *total){
+	int32_t status;
+	if((task < 0) || (task >= CPUISRS)){
+		return -1;
+	}
+	status = StartCritical();
+	*percent = IsrPercent[task];
+	*total = (task == TIMER_NUMTIMERS) ? SysTickTotal : Profile[task].ExecSum;
+	EndCritical(status);
+	return (*total != 0);
+}
+#else
 void Jitter(void){;}
+int OS_CpuInfo(unsigned long slot, unsigned long *id, unsigned long *percent,
+  unsigned long long *total){
+	return -1;
+}
+int OS_IsrCpuInfo(int task, unsigned long *percent, unsigned long long *total){
+	return -1;
+}
+#endif
+
+#ifdef TRACE
+// sends the low n bytes of data, least significant first
+static void TraceSend(uint32_t data, int n){
+	while(n > 0){
+		UART_OutChar(data&0xFF);
+		data = data>>8;
+		n--;
+	}
+}
+
+//******** OS_TraceDump *************** 
+// send the trace buffer over the UART in binary, oldest record first,
+// for trace_decode.py on the host
+// format: "TRCE", version 1, idle thread slot, record count (16 bits),
+// then count 8-byte records of time (32 bits), event, thread, arg (16 bits),
+// all little endian
+// tracing stops while the dump runs so the UART does not trace itself,
+// call it from a thread since the UART output can block
+// Inputs: none
+// Outputs: none
+void OS_TraceDump(void){
+	uint32_t first, count, i;
+	struct tracerecord *rec;
+	g_traceOn = 0;
+	count = (g_traceI < TRACESIZE) ? g_traceI : TRACESIZE;
+	first = g_traceI - count;
+	UART_OutString(TRACEMAGIC);
+	TraceSend(1, 1);
+	TraceSend(NUMTHREADS, 1);
+	TraceSend(count, 2);
+	for(i = 0; i < count; i++){
+		rec = &TraceBuf[(first+i)&(TRACESIZE-1)];
+		TraceSend(rec->Time, 4);
+		TraceSend(rec->Event, 1);
+		TraceSend(rec->Thread, 1);
+		TraceSend(rec->Arg, 2);
+	}
+	g_traceI = 0;  // the next dump starts fresh
+	g_traceOn = 1;
+}
+#else
+void OS_TraceDump(void){;}
+#endif
 
 //__asm  
 
 void SysTick_Handler(void)
 {
 	int status;
-	tcbType* sleepIterator;
+#if defined(DEBUG) || defined(PROFILE)
+	unsigned long start = OS_Time();
+#endif
+#ifdef PROFILE
+	uint32_t isrStart = g_isrTime; // timer tasks nested in this one add to it
+#endif
+	TRACE_EVENT(TRACE_ISRENTER, 15); // exception number of SysTick
 	status = StartCritical();
-#define SYSTICK_PERIOD 1 //Systick interrupts every 1 ms so decrement sleep counters by 1 
-	g_msTime += SYSTICK_PERIOD;
-	
-	if(RunPt->SleepCtr > 0)			//if the sleep counter of the running thread is nonzero, decrement it
-	{
-		RunPt->SleepCtr -= SYSTICK_PERIOD;
+#ifdef TICKLESS
+	if(g_ticklessPeriod != 0)
+	{ // the idle thread slept until the earliest wakeup
+		TimeAdvance(g_ticklessPeriod);
+		g_ticklessPeriod = 0;
+		SysTick_Restart(g_timeSlice);
 	}
-	for(sleepIterator = RunPt->next; sleepIterator != RunPt; sleepIterator = sleepIterator->next)
+	else
+#endif
 	{
-		//Iterate through the linked list until all sleeping threads have been decremented
-		if(sleepIterator->SleepCtr > 0)
-		{
-			sleepIterator->SleepCtr -= SYSTICK_PERIOD;
-		}	
+		TimeAdvance(g_timeSlice); // one time slice, which need not be 1 ms
 	}
-
 	EndCritical(status);
+#ifdef DEBUG
+	SysTickTime = OS_TimeDifference(start, OS_Time());
+	if(SysTickTime > MaxSysTickTime)
+	{
+		MaxSysTickTime = SysTickTime;
+	}
+#endif
+#ifdef PROFILE
+	{
+		unsigned long time = OS_TimeDifference(start, OS_Time());
+		uint32_t nested;
+		status = StartCritical();
+		nested = g_isrTime - isrStart;
+		if(nested < time){
+			time -= nested;   // its own time, the nested timer tasks count theirs
+			SysTickTotal += time;
+			g_isrTime += time;
+		}
+		EndCritical(status);
+	}
+#endif
+	TRACE_EVENT(TRACE_ISREXIT, 15);
 	PE5^=0xFF;
 	OS_Suspend(); //context switch
 	PE5^=0xFF;
@@ -11,7 +11,7 @@
 #define __OS_H  1
 
 // Holds the function pointers to the threads that will be launched
-extern void(*HandlerTaskArray[12])(void); 
+extern void(*HandlerTaskArray[])(void); 
 #include <stdlib.h>
 
 // edit these depending on your clock        
@@ -23,10 +23,73 @@ extern void(*HandlerTaskArray[12])(void);
 // feel free to change the type of semaphore, there are lots of good solutions
 struct  Sema4{
   long Value;   // >0 means free, otherwise means busy        
-// add other components here, if necessary to implement blocking
+  struct tcb *Blocked; // threads waiting on this semaphore, highest priority first
 };
 typedef struct Sema4 Sema4Type;
-extern Sema4Type LCDmutex;
+
+// mutual exclusion lock, only its owner can unlock it and the owner can
+// lock it again, while threads wait for it the owner runs at the priority
+// of the highest one of them
+struct OSMutex{
+  struct tcb *Owner;          // NULL if free
+  unsigned long Count;        // times the owner has locked it
+  Sema4Type Waiters;          // only the blocked list is used, highest priority first
+  struct OSMutex *NextHeld;   // other mutexes held by the same owner
+};
+typedef struct OSMutex OSMutexType;
+
+// single producer single consumer Fifo, elements live in caller storage
+// the fields are only touched by the OS_Fifo functions
+struct OSFifo{
+  unsigned char *Buffer;      // capacity*ElementSize bytes
+  unsigned long ElementSize;  // bytes
+  unsigned long Mask;         // capacity-1, capacity is a power of 2
+  volatile unsigned long PutI;  // only written by the producer
+  volatile unsigned long GetI;  // only written by the consumer
+  volatile unsigned long Want;  // elements the blocked consumer needs, 0 if not waiting
+  Sema4Type Ready;            // binary, signaled once Want elements are there
+};
+typedef struct OSFifo OSFifoType;
+
+// fixed depth message queue, messages are copied in and out of caller storage
+struct OSQueue{
+  unsigned char *Buffer;      // Depth*MsgSize bytes
+  unsigned long MsgSize;      // bytes
+  unsigned long Depth;        // messages
+  unsigned long PutI, GetI;   // 0 to Depth-1
+  Sema4Type Messages;         // counts messages in the queue
+  Sema4Type Room;             // counts free message slots
+};
+typedef struct OSQueue OSQueueType;
+
+// latency and run time of one timer task, times are in bus cycles (12.5ns)
+// histogram bin 0 is under 64 cycles (0.8us) and each next bin is twice
+// as wide, the last bin holds everything longer
+// a one-shot timer has no reload to measure latency from, its calls only
+// count toward the run time
+#define OS_PROFILEBINS 16
+#define OS_NOLATENCY 0xFFFFFFFF  // latency passed for a one-shot timer
+struct OSTaskProfile{
+  unsigned long Count;        // calls since the last OS_ProfileReset
+  unsigned long LatencyCount; // calls with a latency, none for a one-shot timer
+  unsigned long LatencyMin, LatencyMax;  // from the timer timeout to the call
+  unsigned long long LatencySum;
+  unsigned long ExecMin, ExecMax;        // how long the task ran
+  unsigned long long ExecSum;
+  unsigned long LatencyHist[OS_PROFILEBINS];
+  unsigned long ExecHist[OS_PROFILEBINS];
+};
+typedef struct OSTaskProfile OSTaskProfileType;
+
+// software timer, any number of them share one hardware timer
+struct OSTimer{
+  unsigned long long Expire;  // OS_Time64 when it is due
+  unsigned long Period;       // 12.5ns units, 0 for a one-shot
+  void(*Task)(void);          // called from the timer interrupt
+  long Index;                 // place in the timer heap, -1 if not running
+};
+typedef struct OSTimer OSTimerType;
+extern OSMutexType LCDmutex;
 
 // ******** OS_Init ************
 // initialize operating system, disable interrupts until OS_Launch
@@ -43,56 +106,148 @@ void OS_InitSemaphore(Sema4Type *semaPt, long value);
 
 // ******** OS_Wait ************
 // decrement semaphore 
-// Lab2 spinlock
-// Lab3 block if less than zero
+// block if less than zero, the thread leaves the ready lists until signaled
 // input:  pointer to a counting semaphore
 // output: none
 void OS_Wait(Sema4Type *semaPt); 
 
+// ******** OS_WaitTimeout ************
+// decrement a counting semaphore, waiting at most timeout ms for it
+// input:  pointer to a counting semaphore, ms to wait, 0 does not wait
+// output: 1 if the semaphore was taken, 0 if the time ran out
+int OS_WaitTimeout(Sema4Type *semaPt, unsigned long timeout);
+
+// ******** OS_TryWait ************
+// decrement a counting semaphore only if that does not block
+// input:  pointer to a counting semaphore
+// output: 1 if the semaphore was taken, 0 if it was busy
+// can be called from interrupt handlers
+int OS_TryWait(Sema4Type *semaPt);
+
 // ******** OS_Signal ************
 // increment semaphore 
-// Lab2 spinlock
-// Lab3 wakeup blocked thread if appropriate 
+// wakeup the highest priority blocked thread if appropriate 
 // input:  pointer to a counting semaphore
 // output: none
 void OS_Signal(Sema4Type *semaPt); 
 
 // ******** OS_bWait ************
-// Lab2 spinlock, set to 0
-// Lab3 block if less than zero
+// set to 0 if free, otherwise block until signaled
 // input:  pointer to a binary semaphore
 // output: none
 void OS_bWait(Sema4Type *semaPt); 
 
 // ******** OS_bSignal ************
-// Lab2 spinlock, set to 1
-// Lab3 wakeup blocked thread if appropriate 
+// wakeup the highest priority blocked thread, set to 1 if nobody is waiting
 // input:  pointer to a binary semaphore
 // output: none
 void OS_bSignal(Sema4Type *semaPt); 
 
+// ******** OS_MutexInit ************
+// initialize a mutex to be free
+// input:  pointer to the mutex
+// output: none
+void OS_MutexInit(OSMutexType *mutexPt);
+
+// ******** OS_MutexLock ************
+// take a mutex, blocking until it is free, the owner can take it again
+// while a higher priority thread waits, the owner inherits its priority,
+// and so does whoever the owner is waiting on in turn
+// input:  pointer to the mutex
+// output: none
+// only threads may lock a mutex, before OS_Launch main may call it and it
+// does nothing since there is no other thread to exclude
+void OS_MutexLock(OSMutexType *mutexPt);
+
+// ******** OS_MutexTryLock ************
+// take a mutex only if that does not block
+// input:  pointer to the mutex
+// output: 1 if it was taken, 0 if another thread owns it
+int OS_MutexTryLock(OSMutexType *mutexPt);
+
+// ******** OS_MutexUnlock ************
+// undo one OS_MutexLock, the last one hands the mutex to the highest
+// priority waiter and drops the owner back to the priority it had
+// before it was lent one for this mutex
+// input:  pointer to the mutex
+// output: none
+// does nothing if the running thread is not the owner
+void OS_MutexUnlock(OSMutexType *mutexPt);
+
 //******** OS_AddThread *************** 
 // add a foregound thread to the scheduler
 // Inputs: pointer to a void/void foreground task
-//         number of bytes allocated for its stack
-//         priority, 0 is highest, 5 is the lowest
+//         number of 32-bit words allocated for its stack
+//         priority, 0 is highest, 7 is the lowest, EDF threads run
+//         between 0 and 1
 // Outputs: 1 if successful, 0 if this thread can not be added
-// stack size must be divisable by 8 (aligned to double word boundary)
-// In Lab 2, you can ignore both the stackSize and priority fields
-// In Lab 3, you can ignore the stackSize fields
+// stack size is rounded up to a whole number of double words (8 bytes),
+// at least 32 words, and is taken from a shared stack arena
+// the stack is given back to the arena when the thread calls OS_Kill
+// The highest priority ready thread always runs, equal priorities round robin
 int OS_AddThread(void(*task)(void), 
    unsigned long stackSize, unsigned long priority);
 
+// the scheduling level EDF threads run at, in deadline order, no plain
+// thread is put on it, OS_AddThread priority 0 runs above it and
+// priorities 1 to 7 below it
+#define OS_EDFPRIORITY 1
+
+//******** OS_AddEDFThread *************** 
+// add a periodic foreground thread scheduled earliest deadline first
+// Inputs: pointer to a void/void foreground task, a loop that calls
+//         OS_EDFWaitNextPeriod after each job
+//         number of 32-bit words allocated for its stack
+//         period in ms, at least 1
+//         relative deadline in ms, 0 means the end of the period
+// Outputs: 1 if successful, 0 if this thread can not be added
+// EDF threads share OS_EDFPRIORITY, the one due first runs, priority 0
+// threads still preempt them, every other plain thread waits for them
+int OS_AddEDFThread(void(*task)(void), unsigned long stackSize,
+  unsigned long period, unsigned long deadline);
+
+//******** OS_EDFWaitNextPeriod *************** 
+// end the current job of an EDF thread and sleep until its next release,
+// a job finished after its deadline counts as a miss
+// Inputs: none
+// Outputs: none
+void OS_EDFWaitNextPeriod(void);
+
+//******** OS_EDFInfo *************** 
+// report the deadline misses of one thread slot
+// Inputs: slot 0 to NUMTHREADS-1
+//         pointers to where the thread ID, period and relative deadline in
+//         ms, jobs finished and jobs finished late go
+// Outputs: 1 if the slot holds an EDF thread, 0 if it does not,
+//          -1 if slot is past the last one
+int OS_EDFInfo(unsigned long slot, unsigned long *id, unsigned long *period,
+  unsigned long *deadline, unsigned long *jobs, unsigned long *misses);
+
 //******** OS_Id *************** 
 // returns the thread ID for the currently running thread
 // Inputs: none
 // Outputs: Thread ID, number greater than zero 
+// the low 8 bits are the TCB slot, the rest counts how often the slot was
+// reused, so the ID of a thread that was killed never matches a new one
 unsigned long OS_Id(void);
 
+//******** OS_StackInfo *************** 
+// report the peak stack use of one thread slot, unused words are painted
+// when the thread is added and the canary at the bottom of every stack is
+// checked on each context switch
+// Inputs: slot 0 and up, the last slot is the idle thread
+//         pointers to where the thread ID, stack size and peak use go,
+//         sizes are in 32-bit words, overflow is set to 1 if the canary was hit
+// Outputs: 1 if the slot holds a thread, 0 if it is free,
+//          -1 if slot is past the last one
+int OS_StackInfo(unsigned long slot, unsigned long *id, unsigned long *size,
+  unsigned long *peak, unsigned long *overflow);
+
 //******** OS_AddPeriodicThread *************** 
 // add a background periodic task
 // typically this function receives the highest priority
 // Inputs: pointer to a void/void background function
+//         timer 0 to 23 as numbered in TIMER.c
 //         period given in system time units (12.5ns)
 //         priority 0 is the highest, 5 is the lowest
 // Outputs: 1 if successful, 0 if this thread can not be added
@@ -109,6 +264,19 @@ unsigned long OS_Id(void);
 int OS_AddPeriodicThread(void(*task)(void), int timer, 
    unsigned long period, unsigned long priority);
 
+//******** OS_AddPeriodicThreadRate *************** 
+// add a background periodic task that runs at num/den Hz
+// Inputs: pointer to a void/void background function
+//         timer 0 to 23 as numbered in TIMER.c
+//         rate as the fraction num/den Hz, e.g. 2000/1 or 1000/3
+//         priority 0 is the highest, 5 is the lowest
+//         where to put the achieved rate in 0.001 Hz units, can be NULL
+// Outputs: 1 if successful, 0 if this thread can not be added
+// rates that do not divide the bus clock alternate between two period
+// lengths, so the task stays phase locked to the system time over hours
+int OS_AddPeriodicThreadRate(void(*task)(void), int timer, unsigned long num,
+  unsigned long den, unsigned long priority, unsigned long *achieved);
+
 //******** OS_AddSwitchTasks *************** 
 // add a background task to run whenever the SW1 (PF4) button is pushed
 // Inputs: pointer to a void/void background function
@@ -167,15 +335,56 @@ void OS_Kill(void);
 // output: none
 void OS_Suspend(void);
  
+// ******** OS_FifoInit ************
+// make an empty Fifo for one producer and one consumer thread
+// Inputs: pointer to the Fifo, buffer of capacity*elementSize bytes,
+//         bytes per element, capacity a power of 2 and at least 2
+// Outputs: 1 if successful, 0 if capacity is not a power of 2
+// no locks are taken on either side, several Fifos can be used at once
+int OS_FifoInit(OSFifoType *fifo, void *buffer,
+  unsigned long elementSize, unsigned long capacity);
+
+// ******** OS_FifoPut ************
+// enter one element into a Fifo, the producer side
+// Inputs:  pointer to the Fifo, pointer to the element
+// Outputs: 1 if it was saved, 0 if the Fifo was full
+// does not wait, so it can be called from interrupt handlers
+int OS_FifoPut(OSFifoType *fifo, const void *element);
+
+// ******** OS_FifoPutBlock ************
+// enter n elements into a Fifo, all of them or none, the producer side
+// Inputs:  pointer to the Fifo, pointer to the elements, number of elements
+// Outputs: 1 if they were saved, 0 if there was not room for all of them
+int OS_FifoPutBlock(OSFifoType *fifo, const void *elements, unsigned long n);
+
+// ******** OS_FifoGet ************
+// remove one element from a Fifo, the consumer side, blocks if empty
+// Inputs:  pointer to the Fifo, where the element goes
+// Outputs: none
+void OS_FifoGet(OSFifoType *fifo, void *element);
+
+// ******** OS_FifoGetBlock ************
+// remove n elements from a Fifo, the consumer side,
+// blocks once until all n are there
+// Inputs:  pointer to the Fifo, where the elements go, number of elements
+// Outputs: n, 0 if n is more than the Fifo can hold
+unsigned long OS_FifoGetBlock(OSFifoType *fifo, void *elements, unsigned long n);
+
+// ******** OS_FifoSize ************
+// number of elements in a Fifo
+// Inputs:  pointer to the Fifo
+// Outputs: greater than zero if a get will return right away,
+//          zero if the Fifo is empty and a get will block
+long OS_FifoSize(OSFifoType *fifo);
+
+// the OS_Fifo_ functions below use one Fifo of 32-bit samples owned by the OS
+
 // ******** OS_Fifo_Init ************
 // Initialize the Fifo to be empty
-// Inputs: size
+// Inputs: size, rounded down to a power of 2 from 2 to 128 elements
 // Outputs: none 
-// In Lab 2, you can ignore the size field
-// In Lab 3, you should implement the user-defined fifo size
-// In Lab 3, you can put whatever restrictions you want on size
-//    e.g., 4 to 64 elements
-//    e.g., must be a power of 2,4,8,16,32,64,128
+// The Fifo is lock free with one producer (an interrupt handler)
+// and one consumer thread
 void OS_Fifo_Init(unsigned long size);
 
 // ******** OS_Fifo_Put ************
@@ -188,20 +397,34 @@ void OS_Fifo_Init(unsigned long size);
 //  this function can not disable or enable interrupts
 int OS_Fifo_Put(unsigned long data);  
 
+// ******** OS_Fifo_PutBlock ************
+// Enter n data samples into the Fifo, all of them or none
+// Called from the background, so no waiting 
+// Inputs:  pointer to the samples, number of samples
+// Outputs: true if the data is properly saved,
+//          false if nothing was saved, because there was not room for all of it
+int OS_Fifo_PutBlock(const unsigned long *buf, unsigned long n);
+
 // ******** OS_Fifo_Get ************
 // Remove one data sample from the Fifo
-// Called in foreground, will spin/block if empty
+// Called in foreground, will block if empty
 // Inputs:  none
 // Outputs: data 
 unsigned long OS_Fifo_Get(void);
 
+// ******** OS_Fifo_GetBlock ************
+// Remove n data samples from the Fifo
+// Called in foreground, blocks once until all n are there
+// Inputs:  pointer to where the samples go, number of samples
+// Outputs: n, 0 if n is more than the Fifo can hold
+unsigned long OS_Fifo_GetBlock(unsigned long *buf, unsigned long n);
+
 // ******** OS_Fifo_Size ************
 // Check the status of the Fifo
 // Inputs: none
 // Outputs: returns the number of elements in the Fifo
 //          greater than zero if a call to OS_Fifo_Get will return right away
-//          zero or less than zero if the Fifo is empty 
-//          zero or less than zero if a call to OS_Fifo_Get will spin or block
+//          zero if the Fifo is empty and a call to OS_Fifo_Get will block
 long OS_Fifo_Size(void);
 
 // ******** OS_MailBox_Init ************
@@ -226,24 +449,107 @@ void OS_MailBox_Send(unsigned long data);
 // It will spin/block if the MailBox is empty 
 unsigned long OS_MailBox_Recv(void);
 
+// ******** OS_QueueInit ************
+// make an empty message queue in caller storage
+// Inputs: pointer to the queue, buffer of depth*msgSize bytes,
+//         bytes per message, number of messages it holds
+// Outputs: 1 if successful, 0 if depth or msgSize is zero
+// any number of threads may send and receive
+int OS_QueueInit(OSQueueType *queue, void *buffer,
+  unsigned long msgSize, unsigned long depth);
+
+// ******** OS_QueueSend ************
+// enter a message into the queue, blocks while the queue is full
+// Inputs:  pointer to the queue, pointer to the message
+// Outputs: none
+void OS_QueueSend(OSQueueType *queue, const void *msg);
+
+// ******** OS_QueueTrySend ************
+// enter a message into the queue only if there is room
+// Inputs:  pointer to the queue, pointer to the message
+// Outputs: 1 if sent, 0 if the queue was full
+// can be called from interrupt handlers
+int OS_QueueTrySend(OSQueueType *queue, const void *msg);
+
+// ******** OS_QueueSendTimeout ************
+// enter a message into the queue, waiting at most timeout ms for room
+// Inputs:  pointer to the queue, pointer to the message, ms to wait
+// Outputs: 1 if sent, 0 if the time ran out
+int OS_QueueSendTimeout(OSQueueType *queue, const void *msg, unsigned long timeout);
+
+// ******** OS_QueueRecv ************
+// remove the oldest message from the queue, blocks while it is empty
+// Inputs:  pointer to the queue, where the message goes
+// Outputs: none
+void OS_QueueRecv(OSQueueType *queue, void *msg);
+
+// ******** OS_QueueTryRecv ************
+// remove the oldest message only if there is one
+// Inputs:  pointer to the queue, where the message goes
+// Outputs: 1 if a message was received, 0 if the queue was empty
+// can be called from interrupt handlers
+int OS_QueueTryRecv(OSQueueType *queue, void *msg);
+
+// ******** OS_QueueRecvTimeout ************
+// remove the oldest message, waiting at most timeout ms for one
+// Inputs:  pointer to the queue, where the message goes, ms to wait
+// Outputs: 1 if a message was received, 0 if the time ran out
+int OS_QueueRecvTimeout(OSQueueType *queue, void *msg, unsigned long timeout);
+
 // ******** OS_Time ************
-// return the system time 
+// return the lower 32 bits of the system time
 // Inputs:  none
-// Outputs: time in 12.5ns units, 0 to 4294967295
-// The time resolution should be less than or equal to 1us, and the precision 32 bits
-// It is ok to change the resolution and precision of this function as long as 
-//   this function and OS_TimeDifference have the same resolution and precision 
+// Outputs: time in 12.5ns units, 0 to 4294967295, counts up and wraps every 53.7 s
 unsigned long OS_Time(void);
 
+// ******** OS_Time64 ************
+// return the system time since OS_Init, never wraps
+// Inputs:  none
+// Outputs: time in 12.5ns units
+// can be called from any thread or interrupt handler
+unsigned long long OS_Time64(void);
+
 // ******** OS_TimeDifference ************
 // Calculates difference between two times
-// Inputs:  two times measured with OS_Time
+// Inputs:  two times measured with OS_Time, start first
 // Outputs: time difference in 12.5ns units 
-// The time resolution should be less than or equal to 1us, and the precision at least 12 bits
-// It is ok to change the resolution and precision of this function as long as 
-//   this function and OS_Time have the same resolution and precision 
+// correct across a wrap as long as the two are less than 53.7 s apart,
+// use OS_Time64 for longer intervals
 unsigned long OS_TimeDifference(unsigned long start, unsigned long stop);
 
+// ******** OS_TimeToUs ************
+// convert a system time or time difference to microseconds
+// Inputs:  time in 12.5ns units
+// Outputs: time in us
+unsigned long long OS_TimeToUs(unsigned long long time);
+
+// ******** OS_TimeToMs ************
+// convert a system time or time difference to milliseconds
+// Inputs:  time in 12.5ns units
+// Outputs: time in ms
+unsigned long long OS_TimeToMs(unsigned long long time);
+
+// ******** OS_SWTimerInit ************
+// set up a software timer, it does not run until OS_SWTimerStart
+// Inputs:  pointer to the timer, function to call when it expires
+// Outputs: none
+void OS_SWTimerInit(OSTimerType *timer, void(*task)(void));
+
+// ******** OS_SWTimerStart ************
+// start or reschedule a software timer
+// Inputs:  pointer to the timer, 12.5ns units until it first expires,
+//          12.5ns units between expirations after that, 0 for a one-shot
+// Outputs: 1 if successful, 0 if too many timers are running already
+// the task runs in the Timer5A interrupt, so it can not block or sleep,
+// Timer5A can not be given to OS_AddPeriodicThread
+int OS_SWTimerStart(OSTimerType *timer, unsigned long delay, unsigned long period);
+
+// ******** OS_SWTimerCancel ************
+// stop a software timer, nothing happens if it is not running
+// Inputs:  pointer to the timer
+// Outputs: none
+void OS_SWTimerCancel(OSTimerType *timer);
+
 // ******** OS_ClearMsTime ************
 // sets the system time to zero (from Lab 1)
 // Inputs:  none
@@ -269,6 +575,93 @@ unsigned long OS_MsTime(void);
 // It is ok to limit the range of theTimeSlice to match the 24-bit SysTick
 void OS_Launch(unsigned long theTimeSlice);
 
+//******** OS_ProfileTask *************** 
+// record one call of a timer task, called by the timer dispatcher when
+// PROFILE is defined in ifdef.h
+// Inputs: task is the timer 0 to 23 as numbered in TIMER.c
+//         latency is bus cycles from the timer timeout to the task call,
+//           OS_NOLATENCY if it can not be told
+//         exec is bus cycles the task ran, including any interrupts
+//         isrStart is OS_IsrTime when the task was called
+// Outputs: none
+void OS_ProfileTask(int task, unsigned long latency, unsigned long exec,
+  unsigned long isrStart);
+
+//******** OS_IsrTime *************** 
+// free running count of bus cycles spent in timer tasks and SysTick, the
+// timer dispatcher reads it before a task to tell nested interrupts apart
+// Inputs: none
+// Outputs: bus cycles, wraps around
+unsigned long OS_IsrTime(void);
+
+//******** OS_TaskProfile *************** 
+// copy the latency and run time statistics of one timer task
+// Inputs: task is the timer 0 to 23 as numbered in TIMER.c
+//         where to put the statistics
+// Outputs: 1 if the task has run since the last OS_ProfileReset, 0 if not,
+//          -1 if task is past the last timer
+int OS_TaskProfile(int task, OSTaskProfileType *profile);
+
+//******** OS_ProfileReset *************** 
+// clear the statistics of every timer task
+// Inputs: none
+// Outputs: none
+void OS_ProfileReset(void);
+
+//******** OS_CpuInfo *************** 
+// report the CPU use of one thread slot, needs PROFILE defined in ifdef.h
+// Inputs: slot 0 to NUMTHREADS-1, NUMTHREADS is the idle thread
+//         pointers to where the thread ID, its share of the CPU over the
+//         last second in 0.1% units, and the bus cycles it has run go
+// Outputs: 1 if the slot holds a thread, 0 if it is free,
+//          -1 if slot is past the last one
+// time spent in timer tasks and SysTick is not charged to the threads
+int OS_CpuInfo(unsigned long slot, unsigned long *id, unsigned long *percent,
+  unsigned long long *total);
+
+#define OS_SYSTICKTASK 24  // SysTick_Handler in OS_IsrCpuInfo, after the 24 timers
+
+//******** OS_IsrCpuInfo *************** 
+// report the CPU use of one timer task or SysTick, needs PROFILE
+// Inputs: task is the timer 0 to 23 as numbered in TIMER.c, or OS_SYSTICKTASK
+//         pointers to where its share of the CPU over the last second in
+//         0.1% units and the bus cycles it has run go
+// Outputs: 1 if it has run since the last OS_ProfileReset, 0 if not,
+//          -1 if task is past the last one
+int OS_IsrCpuInfo(int task, unsigned long *percent, unsigned long long *total);
+
+// trace buffer events, the thread in each record is the one running
+#define TRACE_SWITCH   0   // context switch, arg is the slot of the thread switched out
+#define TRACE_ISRENTER 1   // arg is the exception number, IRQ+16
+#define TRACE_ISREXIT  2   // arg is the exception number
+#define TRACE_WAIT     3   // arg is the low 16 bits of the semaphore address
+#define TRACE_BLOCK    4   // the wait blocked, arg is the semaphore
+#define TRACE_SIGNAL   5   // arg is the semaphore
+#define TRACE_FIFOPUT  6   // arg is the number of elements after the put
+#define TRACE_FIFOGET  7   // arg is the number of elements after the get
+#define TRACE_USER     8   // free for application events
+
+// ******** OS_Trace ************
+// add one record to the trace buffer, overwriting the oldest one,
+// does nothing unless TRACE is defined in ifdef.h
+// input:  event code and its argument, only the low 16 bits are kept
+// output: none
+// can be called from interrupt handlers
+void OS_Trace(unsigned long event, unsigned long arg);
+
+//******** OS_TraceDump *************** 
+// send the trace buffer over the UART in binary, oldest record first,
+// decode it on the host with trace_decode.py, then start a new trace
+// Inputs: none
+// Outputs: none
+// call it from a thread, the UART output can block
+void OS_TraceDump(void);
+
+//******** Jitter *************** 
+// print the latency and run time of every timer task that has run, in us,
+// and their histograms, needs PROFILE defined in ifdef.h
+// Inputs: none
+// Outputs: none
 void Jitter(void);
 
 #endif
@@ -70,6 +70,58 @@ void PLL_Init(void){
   SYSCTL_RCC2_R &= ~SYSCTL_RCC2_BYPASS2;
 }
 
+#define SYSCTL_RCC_USESYSDIV    0x00400000  // Enable System Clock Divider
+#define SYSCTL_RCC_SYSDIV_M     0x07800000  // System Clock Divisor
+#define SYSCTL_RCC_BYPASS       0x00000800  // PLL Bypass
+#define SYSCTL_RCC_OSCSRC_M     0x00000030  // Oscillator Source
+
+// bus clock in Hz from the current RCC and RCC2 settings, with either
+// register in charge, the PLL or the oscillator, and the divider
+// returns 0 for what it can not tell exactly: a crystal other than the
+// 16 MHz one on the LaunchPad, and the internal 30 kHz oscillator, which
+// is only good to +/-50%
+unsigned long PLL_BusClock(void){
+  uint32_t rcc = SYSCTL_RCC_R;
+  uint32_t rcc2 = SYSCTL_RCC2_R;
+  unsigned long osc, divisor;
+  uint32_t source, bypass;
+  if(rcc2&SYSCTL_RCC2_USERCC2){
+    source = (rcc2&SYSCTL_RCC2_OSCSRC2_M)>>4;
+    bypass = rcc2&SYSCTL_RCC2_BYPASS2;
+    if((rcc2&SYSCTL_RCC2_DIV400) && !bypass){ // SYSDIV2 with its LSB, 400 MHz PLL
+      divisor = ((rcc2&0x1FC00000)>>22)+1;
+    }else{
+      divisor = ((rcc2&SYSCTL_RCC2_SYSDIV2_M)>>23)+1;
+    }
+  }else{
+    source = (rcc&SYSCTL_RCC_OSCSRC_M)>>4;
+    bypass = rcc&SYSCTL_RCC_BYPASS;
+    divisor = ((rcc&SYSCTL_RCC_SYSDIV_M)>>23)+1;
+  }
+  if(!bypass){ // the PLL runs from the crystal or PIOSC at 400 MHz, and the divider is always used
+    if(rcc2&SYSCTL_RCC2_USERCC2){
+      return ((rcc2&SYSCTL_RCC2_DIV400) ? 400000000 : 200000000)/divisor;
+    }
+    return 200000000/divisor;
+  }
+  switch(source){
+    case 0: // main oscillator
+      if((rcc&SYSCTL_RCC_XTAL_M) != SYSCTL_RCC_XTAL_16MHZ){
+        return 0;
+      }
+      osc = 16000000;
+      break;
+    case 1: osc = 16000000; break; // PIOSC
+    case 2: osc = 4000000; break;  // PIOSC/4
+    case 7: osc = 32768; break;    // hibernation oscillator, RCC2 only
+    default: return 0;             // 30 kHz LFIOSC
+  }
+  if(rcc&SYSCTL_RCC_USESYSDIV){
+    return osc/divisor;
+  }
+  return osc;
+}
+
 
 /*
 SYSDIV2  Divisor  Clock (MHz)
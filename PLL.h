@@ -29,6 +29,12 @@
 // configure the system to get its clock from the PLL
 void PLL_Init(void);
 
+// bus clock in Hz read back from RCC and RCC2, so code that turns a
+// rate into bus cycles follows SYSDIV2 instead of assuming 80 MHz
+// 0 if it can not be told exactly (a crystal other than 16 MHz, or the
+// 30 kHz internal oscillator)
+unsigned long PLL_BusClock(void);
+
 
 /*
 SYSDIV2  Divisor  Clock (MHz)
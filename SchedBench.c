@@ -0,0 +1,113 @@
+// SchedBench.c
+// host build of the scheduler core in OS.c with a cycle count benchmark
+// OS.c is compiled as it is, the hardware it calls is stubbed out below,
+// only the ready lists and Scheduler() are run, never a register access
+// build and run on the PC, not part of the Keil project:
+//   gcc -O2 -I. -o SchedBench SchedBench.c && ./SchedBench
+// for each number of sleeping threads it times one Scheduler() call and
+// one pass of the old PendSV round robin walk that skipped the sleepers
+
+#include "OS.c"
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLEUNITS "cycles"
+static unsigned long long Cycles(void){
+	return __rdtsc();
+}
+#else
+#define CYCLEUNITS "ns"
+static unsigned long long Cycles(void){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long)now.tv_sec*1000000000 + now.tv_nsec;
+}
+#endif
+
+#define ITERATIONS 1000000
+
+// what the target gets from osasm.s, startup.s, PLL.c and TIMER.c
+void OS_DisableInterrupts(void){}
+void OS_EnableInterrupts(void){}
+int32_t StartCritical(void){ return 0; }
+void EndCritical(int32_t primask){ (void)primask; }
+void StartOS(void){}
+void WaitForInterrupt(void){}
+void PendSV_Handler(void){}
+void PLL_Init(void){}
+void(*HandlerTaskArray[TIMER_NUMTIMERS])(void);
+int TIMER_TimerInit(void(*task)(void), int timer, unsigned long period, unsigned long priority){ return -1; }
+int TIMER_TimerInitRate(void(*task)(void), int timer, unsigned long num, unsigned long den,
+  unsigned long priority, unsigned long *achieved){ return -1; }
+int TIMER_Reserve(int timer){ return 0; }
+void TIMER_ClearPeriodicTime(int timer){}
+unsigned long TIMER_ReadTimerPeriod(int timer){ return 0; }
+unsigned long TIMER_ReadTimerValue(int timer){ return 0; }
+void TIMER_Start(int timer){}
+void TIMER_Stop(int timer){}
+void TIMER_NVIC_EnableTimerInt(int timer){}
+void TIMER_NVIC_DisableTimerInt(int timer){}
+
+// the round robin ring PendSV_Handler walked before the ready lists
+struct ringtcb{
+	struct ringtcb *next;
+	int32_t SleepCtr;
+};
+struct ringtcb Ring[NUMTHREADS];
+struct ringtcb *volatile RingPt;
+
+// ******** Ring_Switch ************
+// the old context switch, step around the ring past every sleeping thread
+void static Ring_Switch(void){
+	struct ringtcb *pt = RingPt->next;
+	while(pt->SleepCtr != 0){
+		pt = pt->next;
+	}
+	RingPt = pt;
+}
+
+// ******** Bench_Setup ************
+// the last NUMTHREADS-sleeping threads are ready, spread over the
+// OS_AddThread priorities, the rest are asleep and on no ready list
+// the ring has the ready ones last, the worst case for the walk
+void static Bench_Setup(int sleeping){
+	int i;
+	memset(ReadyList, 0, sizeof(ReadyList));
+	g_readyBitmap = 0;
+	for(i = 0; i < NUMTHREADS; i++){
+		tcbs[i].MemStatus = USED;
+		tcbs[i].StackBase = NULL; // no canary to check
+		tcbs[i].ID = i;
+		tcbs[i].Priority = tcbs[i].BasePriority = PRIORITYLEVEL(i%USERPRIORITIES);
+		Ring[i].next = &Ring[(i+1)%NUMTHREADS];
+		Ring[i].SleepCtr = (i < sleeping);
+		if(i >= sleeping){
+			ReadyList_Add(&tcbs[i]);
+		}
+	}
+	RunPt = &tcbs[NUMTHREADS-1];
+	RingPt = &Ring[NUMTHREADS-1];
+}
+
+int main(void){
+	unsigned long long start, scheduler, ring;
+	int sleeping, i;
+	printf("%s per context switch, %d threads\n", CYCLEUNITS, NUMTHREADS);
+	printf("sleeping  Scheduler  round robin\n");
+	for(sleeping = 0; sleeping < NUMTHREADS; sleeping++){
+		Bench_Setup(sleeping);
+		start = Cycles();
+		for(i = 0; i < ITERATIONS; i++){
+			Scheduler();
+		}
+		scheduler = Cycles() - start;
+		start = Cycles();
+		for(i = 0; i < ITERATIONS; i++){
+			Ring_Switch();
+		}
+		ring = Cycles() - start;
+		printf("%8d  %9.1f  %11.1f\n", sleeping,
+		  (double)scheduler/ITERATIONS, (double)ring/ITERATIONS);
+	}
+	return 0;
+}
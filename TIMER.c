@@ -1,17 +1,77 @@
 // Timer.c
+// periodic interrupts on the general purpose timers, driven by one table
+// timer numbers 0-11 are Timer0A, Timer0B, ... Timer5B
+// and 12-23 are WideTimer0A, WideTimer0B, ... WideTimer5B
 
 #include "TIMER.h"
 #include "tm4c123gh6pm.h"
+#include "OS.h"       // trace event codes
+#include "PLL.h"
+#include "ifdef.h"
 
+// register offsets from the base of a timer module, the B half of each
+// per-half register is 4 bytes above the A half
+#define TIMER_CFG    0x000
+#define TIMER_TXMR   0x004
+#define TIMER_CTL    0x00C
+#define TIMER_IMR    0x018
+#define TIMER_RIS    0x01C
+#define TIMER_ICR    0x024
+#define TIMER_TXILR  0x028
+#define TIMER_TXPR   0x038
+#define TIMER_TXR    0x048
+#define TIMER_TXV    0x050
+#define TIMERREG(d,off)     (*(volatile uint32_t *)((d)->Base + (off)))
+#define TIMERHALFREG(d,off) (*(volatile uint32_t *)((d)->Base + (off) + 4*(d)->Half))
+#define TIMERBIT(d,bit)     ((bit)<<(8*(d)->Half)) // TAEN->TBEN, TATOIM->TBTOIM, ...
 
-void(*HandlerTaskArray[12])(void); // Holds the function pointers to the threads that will be launched
+#define NVIC_PRI_BYTE(irq)  (*((volatile uint8_t *)0xE000E400 + (irq)))  // priority in bits 7:5
+#define NVIC_EN_REG(irq)    (*((volatile uint32_t *)0xE000E100 + (irq)/32))
+#define NVIC_DIS_REG(irq)   (*((volatile uint32_t *)0xE000E180 + (irq)/32))
 
-volatile unsigned int* timerCtrlBuf[12] = {TIMER0_CTL_PTR_R, TIMER0_CTL_PTR_R, TIMER1_CTL_PTR_R, TIMER1_CTL_PTR_R,
-																									TIMER2_CTL_PTR_R, TIMER2_CTL_PTR_R, TIMER3_CTL_PTR_R, TIMER3_CTL_PTR_R,
-																									TIMER4_CTL_PTR_R, TIMER4_CTL_PTR_R, TIMER5_CTL_PTR_R, TIMER5_CTL_PTR_R};
+struct timerdesc{
+	uint32_t Base;     // module registers
+	uint8_t Half;      // 0 for A, 1 for B
+	uint8_t IRQ;       // interrupt number
+	uint8_t Module;    // bit in RCGCTIMER or RCGCWTIMER
+	uint8_t Wide;      // 1 for the 32/64-bit wide timers
+};
+typedef const struct timerdesc timerdescType;
 
-static int usedTimers[12];
-static int timerCount = -1;	
+static timerdescType TimerTable[TIMER_NUMTIMERS] = {
+	{0x40030000,0,19,0,0}, {0x40030000,1,20,0,0},  // Timer0A, Timer0B
+	{0x40031000,0,21,1,0}, {0x40031000,1,22,1,0},  // Timer1A, Timer1B
+	{0x40032000,0,23,2,0}, {0x40032000,1,24,2,0},  // Timer2A, Timer2B
+	{0x40033000,0,35,3,0}, {0x40033000,1,36,3,0},  // Timer3A, Timer3B
+	{0x40034000,0,70,4,0}, {0x40034000,1,71,4,0},  // Timer4A, Timer4B
+	{0x40035000,0,92,5,0}, {0x40035000,1,93,5,0},  // Timer5A, Timer5B
+	{0x40036000,0,94,0,1}, {0x40036000,1,95,0,1},  // WideTimer0A, WideTimer0B
+	{0x40037000,0,96,1,1}, {0x40037000,1,97,1,1},  // WideTimer1A, WideTimer1B
+	{0x4004C000,0,98,2,1}, {0x4004C000,1,99,2,1},  // WideTimer2A, WideTimer2B
+	{0x4004D000,0,100,3,1},{0x4004D000,1,101,3,1}, // WideTimer3A, WideTimer3B
+	{0x4004E000,0,102,4,1},{0x4004E000,1,103,4,1}, // WideTimer4A, WideTimer4B
+	{0x4004F000,0,104,5,1},{0x4004F000,1,105,5,1}  // WideTimer5A, WideTimer5B
+};
+
+void(*HandlerTaskArray[TIMER_NUMTIMERS])(void); // Holds the function pointers to the threads that will be launched
+
+// how each module is set up, both halves of a module have to agree
+#define MODULE_UNUSED 0
+#define MODULE_CONCAT 1    // one 32-bit (64-bit wide) timer, only the A half
+#define MODULE_SPLIT  2    // two 16-bit (32-bit wide) timers with prescalers
+static uint8_t ModuleMode[TIMER_NUMTIMERS/2];
+static uint8_t HalfUsed[TIMER_NUMTIMERS];
+
+// a period that is not a whole number of counts is made of Base and Base+1
+// count periods, Step/Modulus of them are the longer ones, so over time the
+// rate is exact instead of drifting by the rounding error
+struct timerdither{
+	uint32_t Base;     // counts in the shorter period
+	uint32_t Step;     // fractional count per period is Step/Modulus
+	uint32_t Modulus;  // 0 if the period is a whole number of counts
+	uint32_t Acc;      // fractional counts carried to the next period
+};
+static struct timerdither Dither[TIMER_NUMTIMERS];
 
 
 void TIMER_ClearPeriodicTime(int timer)
@@ -20,596 +80,323 @@ void TIMER_ClearPeriodicTime(int timer)
 	// it loads it into the TAR register on the next cycle
 	// this has to be done bc the TAR is READ only
 	// where as the TAV has READ/WRITE capabilities.
-	switch(timer)
-	{
-		case 0: // TIMERA0
-			TIMER0_CTL_R &= ~TIMER_CTL_TAEN; // disable TimerA0
-			TIMER0_TAV_R = 0; // set Timer0A Value to 0
-			TIMER0_CTL_R |= TIMER_CTL_TAEN; // enable TimerA0
-			break;
-		
-		case 1: // TIMERB0
-			TIMER0_CTL_R &= ~TIMER_CTL_TBEN; // disable TimerB0
-			TIMER0_TBV_R = 0; // set Timer0B Value to 0
-			TIMER0_CTL_R |= TIMER_CTL_TBEN; // enable TimerB0
-			break;
-		
-		case 2: // TIMERA1
-			TIMER1_CTL_R &= ~TIMER_CTL_TAEN; // disable TimerA1
-			TIMER1_TAV_R = 0; // set Timer1A Value to 0
-			TIMER1_CTL_R |= TIMER_CTL_TAEN; // enable TimerA1
-			break;
-		
-		case 3:	// TIMERB1
-			TIMER1_CTL_R &= ~TIMER_CTL_TBEN; // disable TimerB1
-			TIMER1_TBV_R = 0; // set Timer1B Value to 0
-			TIMER1_CTL_R |= TIMER_CTL_TBEN; // enable TimerB1
-			break;
-		
-		case 4:	// TIMERA2
-			TIMER2_CTL_R &= ~TIMER_CTL_TAEN; // disable TimerA2
-			TIMER2_TAV_R = 0; // set Timer2A Value to 0
-			TIMER2_CTL_R |= TIMER_CTL_TAEN; // enable TimerA2
-			break;
-		
-		case 5:	// TIMERB2
-			TIMER2_CTL_R &= ~TIMER_CTL_TBEN; // disable TimerB2
-			TIMER2_TBV_R = 0; // set Timer2B Value to 0
-			TIMER2_CTL_R |= TIMER_CTL_TBEN; // enable TimerB2
-			break;
-		
-		case 6: // TIMERA3
-			TIMER3_CTL_R &= ~TIMER_CTL_TAEN; // disable TimerA3
-			TIMER3_TAV_R = 0; // set Timer3A Value to 0
-			TIMER3_CTL_R |= TIMER_CTL_TAEN; // enable TimerA3
-			break;
-		
-		case 7:	// TIMERB3
-			TIMER3_CTL_R &= ~TIMER_CTL_TBEN; // disable TimerB3
-			TIMER3_TBV_R = 0; // set Timer3B Value to 0
-			TIMER3_CTL_R |= TIMER_CTL_TBEN; // enable TimerB3
-			break;
-		
-		case 8: // TIMERA4
-			TIMER4_CTL_R &= ~TIMER_CTL_TAEN; // disable TimerA4
-			TIMER4_TAV_R = 0; // set Timer4A Value to 0
-			TIMER4_CTL_R |= TIMER_CTL_TAEN; // enable TimerA4
-			break;
-		
-		case 9: // TIMERB4
-			TIMER4_CTL_R &= ~TIMER_CTL_TBEN; // disable TimerB4
-			TIMER4_TBV_R = 0; // set TimerB4 Value to 0
-			TIMER4_CTL_R |= TIMER_CTL_TBEN; // enable TimerB4
-			break;
-		
-		case 10: // TIMERA5
-			TIMER5_CTL_R &= ~TIMER_CTL_TAEN; // disable TimerA5
-			TIMER5_TAV_R = 0; // set Timer5A Value to 0
-			TIMER5_CTL_R |= TIMER_CTL_TAEN; // enable TimerA5
-			break;
-		
-		case 11: // TIMERB5
-			TIMER5_CTL_R &= ~TIMER_CTL_TBEN; // disable TimerB5
-			TIMER5_TBV_R = 0; // set Timer5B Value to 0
-			TIMER5_CTL_R |= TIMER_CTL_TBEN; // enable TimerB5
-			break;
-		
-		default:
-			break;
+	timerdescType *d;
+	if((timer < 0) || (timer >= TIMER_NUMTIMERS)){
+		return;
 	}
+	d = &TimerTable[timer];
+	TIMERREG(d,TIMER_CTL) &= ~TIMERBIT(d,TIMER_CTL_TAEN); // disable
+	TIMERHALFREG(d,TIMER_TXV) = 0; // set the count to 0
+	TIMERREG(d,TIMER_CTL) |= TIMERBIT(d,TIMER_CTL_TAEN);  // enable
 }
 
 // Returns the number of bus cycles in a full period
 unsigned long TIMER_ReadTimerPeriod(int timer)
 {
-	unsigned long busCyclePerPeriod = 0;
-	switch(timer)
-	{
-		case 0:
-			busCyclePerPeriod = TIMER0_TAILR_R;
-			break;
-		
-		case 1:
-			busCyclePerPeriod = TIMER0_TBILR_R;
-			break;
-		
-		case 2:
-			busCyclePerPeriod = TIMER1_TAILR_R;
-			break;
-		
-		case 3:
-			busCyclePerPeriod = TIMER1_TBILR_R;
-			break;
-		
-		case 4:
-			busCyclePerPeriod = TIMER2_TAILR_R;
-			break;
-		
-		case 5:
-			busCyclePerPeriod = TIMER2_TBILR_R;
-			break;
-		
-		case 6:
-			busCyclePerPeriod = TIMER3_TAILR_R;
-			break;
-		
-		case 7:
-			busCyclePerPeriod = TIMER3_TBILR_R;
-			break;
-		
-		case 8:
-			busCyclePerPeriod = TIMER4_TAILR_R;
-			break;
-		
-		case 9:
-			busCyclePerPeriod = TIMER4_TBILR_R;
-			break;
-		
-		case 10:
-			busCyclePerPeriod = TIMER5_TAILR_R;
-			break;
-		
-		case 11:
-			busCyclePerPeriod = TIMER5_TBILR_R;
-			break;
-		
-		default:
-			break;
+	timerdescType *d;
+	if((timer < 0) || (timer >= TIMER_NUMTIMERS)){
+		return 0;
+	}
+	d = &TimerTable[timer];
+	if(ModuleMode[timer/2] == MODULE_SPLIT){ // the prescaler extends the count
+		return (TIMERHALFREG(d,TIMER_TXILR)+1)*(TIMERHALFREG(d,TIMER_TXPR)+1);
 	}
-	return busCyclePerPeriod;
+	return TIMERHALFREG(d,TIMER_TXILR)+1;
 }
 
 
 
-// this configures the timers for 32-bit mode, periodic mode
-int TIMER_TimerInit(void(*task)(void), int timer, unsigned long desiredFrequency, unsigned long priority)
+// ******** Timer_Setup ************
+// configures a timer for periodic interrupts
+// an A half runs as one concatenated 32-bit timer unless its B half is
+// already in use, a B half runs in split mode: 16 bits with an 8-bit
+// prescaler (32 bits on the wide timers)
+// cycles is the period in bus cycles, it picks the prescaler
+// returns the prescaler, each count is (prescaler+1) bus cycles,
+// -1 if the timer does not exist, the period does not fit, or the other
+// half of the module is set up the other way
+// the interval load is left for the caller
+static int Timer_Setup(void(*task)(void), int timer, unsigned long cycles, unsigned long priority)
 {
 	int delay;
-	unsigned long cyclesPerPeriod;
-	
-	// will fail if frequency is a decimal number close to 0 relative to the bus speed
-	cyclesPerPeriod = CLOCKSPEED_80MHZ/desiredFrequency; 
-	
-	switch(timer)
-	{
-		case 0:		//TimerA0
-			SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R0;   // activate timer0
-			delay = SYSCTL_RCGCTIMER_R;   // allow time to finish activating
-			TIMER0_CTL_R &= ~TIMER_CTL_TAEN; // disable TimerA0
-			TIMER0_CFG_R  = TIMER_CFG_32_BIT_TIMER; // configure for 32-bit mode
-			TIMER0_TAMR_R = TIMER_TAMR_TAMR_PERIOD;
-			TIMER0_TAILR_R = cyclesPerPeriod-1;
-			TIMER0_TAPR_R = 0; // set prescale = 0
-			TIMER0_ICR_R = TIMER_ICR_TATOCINT; // clear timeout flag, friendly since writing a 0 does nothing
-			TIMER0_IMR_R |= TIMER_IMR_TATOIM; // arm the timeout interrupt
-			NVIC_PRI4_R = (NVIC_PRI4_R & ~NVIC_PRI4_INT19_M)|(priority << NVIC_PRI4_INT19_S); //clears PRI bits then shifts the mask into the appropriate place
-			//TIMER0_CTL_R |= TIMER_CTL_TAEN; // enable TimerA0, do this in OS_Launch(.)
-			HandlerTaskArray[0] = task; // fill function pointer array w/address of task
-			break;
-		
-		case 1:  	//TimerB0
-			SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R0;   // activate timer0
-			delay = SYSCTL_RCGCTIMER_R;   // allow time to finish activating
-		  TIMER0_CTL_R &= ~TIMER_CTL_TBEN; // disable TimerB0
-			TIMER0_CFG_R  = TIMER_CFG_32_BIT_TIMER; // configure for 32-bit mode
-			TIMER0_TBMR_R = TIMER_TBMR_TBMR_PERIOD;
-			TIMER0_TBILR_R = cyclesPerPeriod-1;
-			TIMER0_TBPR_R = 0; // set prescale = 0
-			TIMER0_ICR_R = TIMER_ICR_TBTOCINT; // clear timeout flag, friendly since writing a 0 does nothing
-			TIMER0_IMR_R |= TIMER_IMR_TBTOIM; // arm the timeout interrupt
-			NVIC_PRI5_R = (NVIC_PRI5_R & ~NVIC_PRI5_INT20_M)|(priority << NVIC_PRI5_INT20_S); //clears PRI bits then shifts the mask into the appropriate place
-			//TIMER0_CTL_R |= TIMER_CTL_TBEN; // enable TimerB0, do this in OS_Launch(.)
-			HandlerTaskArray[1] = task; // fill function pointer array w/address of task
-			break;
-		
-		case 2:		//TimerA1
-			SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R1;   // activate timer1
-			delay = SYSCTL_RCGCTIMER_R;   // allow time to finish activating
-			TIMER1_CTL_R &= ~TIMER_CTL_TAEN; // disable TimerA1
-			TIMER1_CFG_R  = TIMER_CFG_32_BIT_TIMER; // configure for 32-bit mode
-			TIMER1_TAMR_R = TIMER_TAMR_TAMR_PERIOD;
-			TIMER1_TAILR_R = cyclesPerPeriod-1;
-			TIMER1_TAPR_R = 0; // set prescale = 0
-			TIMER1_ICR_R = TIMER_ICR_TATOCINT; // clear timeout flag, friendly since writing a 0 does nothing
-			TIMER1_IMR_R |= TIMER_IMR_TATOIM; // arm the timeout interrupt
-			NVIC_PRI5_R = (NVIC_PRI5_R & ~NVIC_PRI5_INT21_M)|(priority << NVIC_PRI5_INT21_S); //clears PRI bits then shifts the mask into the appropriate place
-			//TIMER1_CTL_R |= TIMER_CTL_TAEN; // enable TimerA1, do this in OS_Launch(.)
-			HandlerTaskArray[2] = task; // fill function pointer array w/address of task
-			break;
-		
-		case 3:		//TimerB1
-			SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R1;   // activate timer1
-			delay = SYSCTL_RCGCTIMER_R;   // allow time to finish activating
-			TIMER1_CTL_R &= ~TIMER_CTL_TBEN; // disable TimerB1
-			TIMER1_CFG_R  = TIMER_CFG_32_BIT_TIMER; // configure for 32-bit mode
-			TIMER1_TBMR_R = TIMER_TBMR_TBMR_PERIOD;
-			TIMER1_TBILR_R = cyclesPerPeriod-1;
-			TIMER1_TBPR_R = 0; // set prescale = 0
-			TIMER1_ICR_R = TIMER_ICR_TBTOCINT; // clear timeout flag, friendly since writing a 0 does nothing
-			TIMER1_IMR_R |= TIMER_IMR_TBTOIM; // arm the timeout interrupt
-			NVIC_PRI5_R = (NVIC_PRI5_R & ~NVIC_PRI5_INT22_M)|(priority << NVIC_PRI5_INT22_S);
-			//TIMER1_CTL_R |= TIMER_CTL_TBEN; // enable TimerB1, do this in OS_Launch(.)
-			HandlerTaskArray[3] = task; // fill function pointer array w/address of tasks
-			break;
-		
-		case 4:		//TimerA2
-			SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R2;   // activate timer2
-			delay = SYSCTL_RCGCTIMER_R;   // allow time to finish activating
-			TIMER2_CTL_R &= ~TIMER_CTL_TAEN; // disable TimerA2
-			TIMER2_CFG_R  = TIMER_CFG_32_BIT_TIMER; // configure for 32-bit mode
-			TIMER2_TAMR_R = TIMER_TAMR_TAMR_PERIOD;
-			TIMER2_TAILR_R = cyclesPerPeriod-1;
-			TIMER2_TAPR_R = 0; // set prescale = 0
-			TIMER2_ICR_R = TIMER_ICR_TATOCINT; // clear timeout flag, friendly since writing a 0 does nothing
-			TIMER2_IMR_R |= TIMER_IMR_TATOIM; // arm the timeout interrupt
-			NVIC_PRI5_R = (NVIC_PRI5_R & ~NVIC_PRI5_INT23_M)|(priority << NVIC_PRI5_INT23_S); //clears PRI bits then shifts the mask into the appropriate place
-			//TIMER2_CTL_R |= TIMER_CTL_TAEN; // enable TimerA2, do this in OS_Launch(.)
-			HandlerTaskArray[4] = task; // fill function pointer array w/address of tasks
-			break;
-		
-		case 5:		//TimerB2
-			SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R2;   // activate timer2
-			delay = SYSCTL_RCGCTIMER_R;   // allow time to finish activating
-			TIMER2_CTL_R &= ~TIMER_CTL_TBEN; // disable TimerB2
-			TIMER2_CFG_R  = TIMER_CFG_32_BIT_TIMER; // configure for 32-bit mode
-			TIMER2_TBMR_R = TIMER_TBMR_TBMR_PERIOD;
-			TIMER2_TBILR_R = cyclesPerPeriod-1;
-			TIMER2_TBPR_R = 0; // set prescale = 0
-			TIMER2_ICR_R = TIMER_ICR_TBTOCINT; // clear timeout flag, friendly since writing a 0 does nothing
-			TIMER2_IMR_R |= TIMER_IMR_TBTOIM; // arm the timeout interrupt
-			NVIC_PRI6_R = (NVIC_PRI6_R & ~NVIC_PRI6_INT24_M)|(priority << NVIC_PRI6_INT24_S); //clears PRI bits then shifts the mask into the appropriate place
-			//TIMER2_CTL_R |= TIMER_CTL_TBEN; // enable TimerB2, do this in OS_Launch(.)
-			HandlerTaskArray[5] = task; // fill function pointer array w/address of tasks
-			break;
-		
-		case 6:		//TimerA3
-			SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R3;   // activate timer3
-			delay = SYSCTL_RCGCTIMER_R;   // allow time to finish activating
-			TIMER3_CTL_R &= ~TIMER_CTL_TAEN; // disable TimerA3
-			TIMER3_CFG_R  = TIMER_CFG_32_BIT_TIMER; // configure for 32-bit mode
-			TIMER3_TAMR_R = TIMER_TAMR_TAMR_PERIOD;
-			TIMER3_TAILR_R = cyclesPerPeriod-1;
-			TIMER3_TAPR_R = 0; // set prescale = 0
-			TIMER3_ICR_R = TIMER_ICR_TATOCINT; // clear timeout flag, friendly since writing a 0 does nothing
-			TIMER3_IMR_R |= TIMER_IMR_TATOIM; // arm the timeout interrupt
-			NVIC_PRI8_R = (NVIC_PRI8_R & ~NVIC_PRI8_INT35_M)|(priority << NVIC_PRI8_INT35_S); //clears PRI bits then shifts the mask into the appropriate place
-			//TIMER3_CTL_R |= TIMER_CTL_TAEN; // enable TimerA3, do this in OS_Launch(.)
-			HandlerTaskArray[6] = task; // fill function pointer array w/address of tasks
-			break;
-		
-		case 7:		//TimerB3
-			SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R3;   // activate timer3
-			delay = SYSCTL_RCGCTIMER_R;   // allow time to finish activating
-			TIMER3_CTL_R &= ~TIMER_CTL_TBEN; // disable TimerB3
-			TIMER3_CFG_R  = TIMER_CFG_32_BIT_TIMER; // configure for 32-bit mode
-			TIMER3_TBMR_R = TIMER_TBMR_TBMR_PERIOD;
-			TIMER3_TBILR_R = cyclesPerPeriod-1;
-			TIMER3_TBPR_R = 0; // set prescale = 0
-			TIMER3_ICR_R = TIMER_ICR_TBTOCINT; // clear timeout flag, friendly since writing a 0 does nothing
-			TIMER3_IMR_R |= TIMER_IMR_TBTOIM; // arm the timeout interrupt
-			NVIC_PRI9_R = (NVIC_PRI9_R & ~NVIC_PRI9_INT36_M)|(priority << NVIC_PRI9_INT36_S); //clears PRI bits then shifts the mask into the appropriate place
-			//TIMER3_CTL_R |= TIMER_CTL_TBEN; // enable TimerB3, do this in OS_Launch(.)
-			HandlerTaskArray[7] = task; // fill function pointer array w/address of tasks
-			break;
-		
-		case 8:		//TimerA4
-			SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R4;   // activate timer4
-			delay = SYSCTL_RCGCTIMER_R;   // allow time to finish activating
-			TIMER4_CTL_R &= ~TIMER_CTL_TAEN; // disable TimerA4
-			TIMER4_CFG_R  = TIMER_CFG_32_BIT_TIMER; // configure for 32-bit mode
-			TIMER4_TAMR_R = TIMER_TAMR_TAMR_PERIOD;
-			TIMER4_TAILR_R = cyclesPerPeriod-1;
-			TIMER4_TAPR_R = 0; // set prescale = 0
-			TIMER4_ICR_R = TIMER_ICR_TATOCINT; // clear timeout flag, friendly since writing a 0 does nothing
-			TIMER4_IMR_R |= TIMER_IMR_TATOIM; // arm the timeout interrupt
-			NVIC_PRI17_R = (NVIC_PRI17_R & ~NVIC_PRI17_INTC_M)|(priority << NVIC_PRI17_INTC_S); //clears PRI bits then shifts the mask into the appropriate place
-			//TIMER4_CTL_R |= TIMER_CTL_TAEN; // enable TimerA4, do this in OS_Launch(.)
-			HandlerTaskArray[8] = task; // fill function pointer array w/address of tasks
-			break;
-		
-		case 9:		//TimerB4
-			SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R4;   // activate timer4
-			delay = SYSCTL_RCGCTIMER_R;   // allow time to finish activating
-			TIMER4_CTL_R &= ~TIMER_CTL_TBEN; // disable TimerB4
-			TIMER4_CFG_R  = TIMER_CFG_32_BIT_TIMER; // configure for 32-bit mode
-			TIMER4_TBMR_R = TIMER_TBMR_TBMR_PERIOD;
-			TIMER4_TBILR_R = cyclesPerPeriod-1;
-			TIMER4_TBPR_R = 0; // set prescale = 0
-			TIMER4_ICR_R = TIMER_ICR_TBTOCINT; // clear timeout flag, friendly since writing a 0 does nothing
-			TIMER4_IMR_R |= TIMER_IMR_TBTOIM; // arm the timeout interrupt
-			NVIC_PRI17_R = (NVIC_PRI17_R & ~NVIC_PRI17_INTD_M)|(priority << NVIC_PRI17_INTD_S); //clears PRI bits then shifts the mask into the appropriate place
-			//TIMER4_CTL_R |= TIMER_CTL_TBEN; // enable TimerB4, do this in OS_Launch(.)
-			HandlerTaskArray[9] = task; // fill function pointer array w/address of tasks
-			break;
-		
-		case 10:	//TimerA5
-			SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R5;   // activate timer5
-			delay = SYSCTL_RCGCTIMER_R;   // allow time to finish activating
-			TIMER5_CTL_R &= ~TIMER_CTL_TAEN; // disable TimerA5
-			TIMER5_CFG_R  = TIMER_CFG_32_BIT_TIMER; // configure for 32-bit mode
-			TIMER5_TAMR_R = TIMER_TAMR_TAMR_PERIOD;
-			TIMER5_TAILR_R = cyclesPerPeriod-1;
-			TIMER5_TAPR_R = 0; // set prescale = 0
-			TIMER5_ICR_R = TIMER_ICR_TATOCINT; // clear timeout flag, friendly since writing a 0 does nothing
-			TIMER5_IMR_R |= TIMER_IMR_TATOIM; // arm the timeout interrupt
-			NVIC_PRI23_R = (NVIC_PRI23_R & ~NVIC_PRI23_INTA_M)|(priority << NVIC_PRI23_INTA_S); //clears PRI bits then shifts the mask into the appropriate place
-			//TIMER5_CTL_R |= TIMER_CTL_TAEN; // enable TimerA5, do this in OS_Launch(.)
-			HandlerTaskArray[10] = task; // fill function pointer array w/address of tasks
-			break;
-		
-		case 11:	//TimerB5
-			SYSCTL_RCGCTIMER_R |= SYSCTL_RCGCTIMER_R5;   // activate timer5
-			delay = SYSCTL_RCGCTIMER_R;   // allow time to finish activating
-			TIMER5_CTL_R &= ~TIMER_CTL_TBEN; // disable TimerB5
-			TIMER5_CFG_R  = TIMER_CFG_32_BIT_TIMER; // configure for 32-bit mode
-			TIMER5_TBMR_R = TIMER_TBMR_TBMR_PERIOD;
-			TIMER5_TBILR_R = cyclesPerPeriod-1;
-			TIMER5_TBPR_R = 0; // set prescale = 0
-			TIMER5_ICR_R = TIMER_ICR_TBTOCINT; // clear timeout flag, friendly since writing a 0 does nothing
-			TIMER5_IMR_R |= TIMER_IMR_TBTOIM; // arm the timeout interrupt
-			NVIC_PRI23_R = (NVIC_PRI23_R & ~NVIC_PRI23_INTB_M)|(priority << NVIC_PRI23_INTB_S); //clears PRI bits then shifts the mask into the appropriate place
-			//TIMER5_CTL_R |= TIMER_CTL_TBEN; // enable TimerB5, do this in OS_Launch(.)
-			HandlerTaskArray[11] = task; // fill function pointer array w/address of tasks
-			break;
-		
-		default:
+	unsigned long prescale;
+	timerdescType *d;
+	int module, mode;
+
+	if((timer < 0) || (timer >= TIMER_NUMTIMERS) || (cycles < 2)){
+		return -1;
+	}
+	d = &TimerTable[timer];
+	module = timer/2;
+	if(d->Half == 1){
+		mode = MODULE_SPLIT;
+	}else if(HalfUsed[timer+1]){
+		mode = MODULE_SPLIT; // share the module with the B half
+	}else{
+		mode = MODULE_CONCAT;
+	}
+	if(HalfUsed[timer^1] && (ModuleMode[module] != mode)){
+		return -1; // the other half needs the module set up the other way
+	}
+	prescale = 0;
+	if((mode == MODULE_SPLIT) && !d->Wide){ // a 32-bit wide half covers every period without one
+		prescale = (cycles-1)>>16;
+		if(prescale > 0xFF){
 			return -1;
+		}
 	}
-	
-	timerCount++; // used for launching the correct number of threads that were successfully initialized
-	usedTimers[timerCount] = timer; // store the timerID of which timer to launch
-	return 0;
-}
 
-// Read Timer Count in the timer																									
-unsigned long TIMER_ReadTimerValue(int timer)
-{
-	int32_t status;
-	unsigned long count;
-	status = StartCritical(); // if it interrupts after it read thhe
-	// value from TIMERX_TAR_R and then interrupts before leaving
-	// it will return an incorrect Timer count value
-	switch(timer)
-	{
-		case 0: // TimerA0
-			count =  TIMER0_TAR_R; // Read value, x, stored in Timer0, 0 < x < TIMER0_TAILR
-			break;
-		
-		case 1: // TimerB0
-			count = TIMER0_TBR_R; // Read value, x, stored in Timer0, 0 < x < TIMER0_TBILR
-			break;
-			
-		case 2: // TimerA1
-			count = TIMER1_TAR_R; // Read value, x, stored in Timer1, 0 < x < TIMER1_TAILR
-			break;
-		
-		case 3: // TimerB1
-			count = TIMER1_TBR_R; // Read value, x, stored in Timer1, 0 < x < TIMER1_TBILR
-			break;
-		
-		case 4: // TimerA2
-			count = TIMER2_TAR_R; // Read value, x, stored in Timer2, 0 < x < TIMER2_TAILR
-			break;
-		
-		case 5: // TimerB2
-			count = TIMER2_TBR_R; // Read value, x, stored in Timer2, 0 < x < TIMER2_TBILR
-			break;
-		
-		case 6: // TimerA3
-			count = TIMER3_TAR_R; // Read value, x, stored in Timer3, 0 < x < TIMER3_TAILR
-			break;
-		
-		case 7: // TimerB3
-			count = TIMER3_TBR_R; // Read value, x, stored in Timer3, 0 < x < TIMER3_TBILR
-			break;
-		
-		case 8: // TimerA4
-			count = TIMER4_TAR_R; // Read value, x, stored in Timer4, 0 < x < TIMER4_TAILR
-			break;
-		
-		case 9: // TimerB4
-			count = TIMER4_TBR_R; // Read value, x, stored in Timer4, 0 < x < TIMER4_TBILR
-			break;
-		
-		case 10: // TimerA5
-			count = TIMER5_TAR_R; // Read value, x, stored in Timer5, 0 < x < TIMER5_TAILR
-			break;
-		
-		case 11: // timerB5
-			count = TIMER5_TBR_R; // Read value, x, stored in Timer5, 0 < x < TIMER5_TBILR
-			break;
-		
-		default:
-			break;
+	if(d->Wide){
+		SYSCTL_RCGCWTIMER_R |= (1<<d->Module);  // activate the wide timer
+		delay = SYSCTL_RCGCWTIMER_R;  // allow time to finish activating
+	}else{
+		SYSCTL_RCGCTIMER_R |= (1<<d->Module);   // activate the timer
+		delay = SYSCTL_RCGCTIMER_R;   // allow time to finish activating
 	}
-	EndCritical(status);
-	return count;
-}
-
-
-// enables interrupts in the NVIC vector table
-// setting the bit enables the interrupt, trying to
-// clear the bit has no effect in disabling the interrupts
-// it requires setting the appropriate bits in the DIS Registers
-void TIMER_NVIC_EnableTimerInt(int timer)
-{
-	switch(timer)
-	{
-		case 0: // Timer0A
-			NVIC_EN0_R = NVIC_EN0_INT19;
-			break;
-		
-		case 1: // Timer0B
-			NVIC_EN0_R = NVIC_EN0_INT20;
-			break;
-		
-		case 2: // Timer1A
-			NVIC_EN0_R = NVIC_EN0_INT21;
-			break;
-			
-		case 3: // Timer1B
-			NVIC_EN0_R = NVIC_EN0_INT22;
-			break;
-			
-		case 4: // Timer2A
-			NVIC_EN0_R = NVIC_EN0_INT23;
-			break;
-		
-		case 5: // Timer2B
-			NVIC_EN0_R = NVIC_EN0_INT24;
-			break;
-		
-		case 6: // Timer3A
-			NVIC_EN1_R = NVIC_EN1_INT35;
-			break;
-			
-		case 7: // Timer3B
-			NVIC_EN1_R = NVIC_EN1_INT36;
-			break;
-		
-		case 8: // Timer4A
-			NVIC_EN2_R = NVIC_EN2_INT70;
-			break;
-			
-		case 9: // Timer4B
-			NVIC_EN2_R = NVIC_EN2_INT71;
-			break;
-			
-		case 10: // Timer5A
-			NVIC_EN2_R = NVIC_EN2_INT92;
-			break;
-		case 11: // Timer5B
-			NVIC_EN2_R = NVIC_EN2_INT93;
-			break;
+	TIMERREG(d,TIMER_CTL) &= ~TIMERBIT(d,TIMER_CTL_TAEN); // disable this half
+	if(!HalfUsed[timer^1]){ // CFG can only change while both halves are off
+		TIMERREG(d,TIMER_CFG) = (mode == MODULE_SPLIT) ? TIMER_CFG_16_BIT : TIMER_CFG_32_BIT_TIMER;
 	}
-}				
-
-// disables interrupts in the NVIC vector table
-// setting the bit disables the interrupt, trying to
-// clear the bit has no effect in re-enabling the interrupts
-// it requires setting the appropriate bits in the EN Registers
-void TIMER_NVIC_DisableTimerInt(int timer)
-{
-	switch(timer)
-	{
-		case 0: // Timer0A
-			NVIC_DIS0_R = NVIC_DIS0_INT19;
-			break;
-		
-		case 1: // Timer0B
-			NVIC_DIS0_R = NVIC_DIS0_INT20;
-			break;
-		
-		case 2: // Timer1A
-			NVIC_DIS0_R = NVIC_DIS0_INT21;
-			break;
-			
-		case 3: // Timer1B
-			NVIC_DIS0_R = NVIC_DIS0_INT22;
-			break;
-			
-		case 4: // Timer2A
-			NVIC_DIS0_R = NVIC_DIS0_INT23;
-			break;
-		
-		case 5: // Timer2B
-			NVIC_DIS0_R = NVIC_DIS0_INT24;
-			break;
-		
-		case 6: // Timer3A
-			NVIC_DIS1_R = NVIC_DIS1_INT35;
-			break;
-			
-		case 7: // Timer3B
-			NVIC_DIS1_R = NVIC_DIS1_INT36;
-			break;
-		
-		case 8: // Timer4A
-			NVIC_DIS2_R = NVIC_DIS2_INT70;
-			break;
-			
-		case 9: // Timer4B
-			NVIC_DIS2_R = NVIC_DIS2_INT71;
-			break;
-			
-		case 10: // Timer5A
-			NVIC_DIS2_R = NVIC_DIS2_INT92;
-			break;
-		case 11: // Timer5B
-			NVIC_DIS2_R = NVIC_DIS2_INT93;
-			break;
+	ModuleMode[module] = mode;
+	HalfUsed[timer] = 1;
+	Dither[timer].Modulus = 0;
+	// a new interval load takes effect at the next timeout, not right away
+	TIMERHALFREG(d,TIMER_TXMR) = TIMER_TAMR_TAMR_PERIOD|TIMER_TAMR_TAILD;
+	if(d->Wide && (mode == MODULE_CONCAT)){
+		TIMERREG(d,TIMER_TXILR+4) = 0; // upper 32 bits of the 64-bit count
 	}
-}																							
-
-void Timer0A_Handler(void)
-{
-	TIMER0_ICR_R = TIMER_ICR_TATOCINT; // acknowledge interrupt flag
-	(*(HandlerTaskArray[0]))(); // start Timer0A task
+	TIMERHALFREG(d,TIMER_TXPR) = prescale;
+	TIMERREG(d,TIMER_ICR) = TIMERBIT(d,TIMER_ICR_TATOCINT); // clear timeout flag, friendly since writing a 0 does nothing
+	TIMERREG(d,TIMER_IMR) |= TIMERBIT(d,TIMER_IMR_TATOIM);  // arm the timeout interrupt
+	NVIC_PRI_BYTE(d->IRQ) = (priority&0x07)<<5;
+	//the timer is enabled by TIMER_Start, do this in OS_Launch(.)
+	HandlerTaskArray[timer] = task; // fill function pointer array w/address of task
+	return prescale;
 }
 
-void Timer0B_Handler(void)
+// this configures a timer for periodic interrupts
+// period is in bus cycles (12.5ns), in split mode with a prescaler it is
+// rounded to a whole number of prescaled counts
+// returns 0 if successful, -1 if the timer does not exist, the period does
+// not fit, the bus clock is unknown, or the other half of the module is
+// set up the other way
+int TIMER_TimerInit(void(*task)(void), int timer, unsigned long period, unsigned long priority)
 {
-	TIMER0_ICR_R = TIMER_ICR_TBTOCINT; // acknowledge interrupt flag
-	(*(HandlerTaskArray[1]))(); // start Timer0B task
+	int prescale = Timer_Setup(task, timer, period, priority);
+	if(prescale < 0){
+		return -1;
+	}
+	TIMERHALFREG(&TimerTable[timer],TIMER_TXILR) = (period+(prescale+1)/2)/(prescale+1)-1;
+	return 0;
 }
 
-void Timer1A_Handler(void)
+// this configures a timer for periodic interrupts at num/den Hz
+// when the bus clock is not a whole multiple of the rate, the period is
+// switched between two lengths so the average rate is exact, without drift
+// achieved gets the long term rate in 0.001 Hz units, it can be NULL
+// returns 0 if successful, -1 if the timer does not exist, the period does
+// not fit, the bus clock is unknown, or the other half of the module is
+// set up the other way
+int TIMER_TimerInitRate(void(*task)(void), int timer, unsigned long num, unsigned long den,
+  unsigned long priority, unsigned long *achieved)
 {
-	TIMER1_ICR_R = TIMER_ICR_TATOCINT; // acknowledge interrupt flag
-	(*(HandlerTaskArray[2]))(); // start Timer1A task
+	unsigned long long cycles, modulus;
+	unsigned long clock = PLL_BusClock();
+	uint32_t counts;
+	int prescale;
+	if((num == 0) || (den == 0) || (clock == 0)){
+		return -1;
+	}
+	cycles = (unsigned long long)clock*den;  // num periods take this many bus cycles
+	if(cycles/num >= 0xFFFFFFFF){ // a period of 2^32 bus cycles (53.7 s at 80 MHz) or more does not fit
+		return -1;
+	}
+	prescale = Timer_Setup(task, timer, cycles/num, priority);
+	if(prescale < 0){
+		return -1;
+	}
+	modulus = (unsigned long long)num*(prescale+1);     // counts per period is cycles/modulus
+	counts = cycles/modulus;
+	if(modulus <= 0xFFFFFFFF){
+		Dither[timer].Base = counts;
+		Dither[timer].Step = cycles%modulus;
+		Dither[timer].Acc = 0;
+		Dither[timer].Modulus = (Dither[timer].Step != 0) ? modulus : 0;
+		if(achieved != NULL){
+			*achieved = ((unsigned long long)num*1000 + den/2)/den;
+		}
+	}else{ // too fine to dither, round to the nearest count
+		counts = (cycles + modulus/2)/modulus;
+		if(achieved != NULL){
+			*achieved = ((unsigned long long)clock*1000)/((unsigned long long)counts*(prescale+1));
+		}
+	}
+	TIMERHALFREG(&TimerTable[timer],TIMER_TXILR) = counts-1;
+	return 0;
 }
 
-void Timer1B_Handler(void)
+// marks the A half of a module as one concatenated timer that is set up
+// somewhere else, so TIMER_TimerInit will not touch its module
+// returns 0 if successful, -1 if it is not an A half or either half of
+// the module is already in use
+int TIMER_Reserve(int timer)
 {
-	TIMER1_ICR_R = TIMER_ICR_TBTOCINT; // acknowledge interrupt flag
-	(*(HandlerTaskArray[3]))(); // start Timer1B task
+	if((timer < 0) || (timer >= TIMER_NUMTIMERS) || (timer&1) ||
+	   HalfUsed[timer] || HalfUsed[timer+1]){
+		return -1;
+	}
+	HalfUsed[timer] = 1;
+	ModuleMode[timer/2] = MODULE_CONCAT;
+	return 0;
 }
 
-void Timer2A_Handler(void)
+// releases a timer set up by TIMER_TimerInit, stops it first
+void TIMER_TimerFree(int timer)
 {
-	TIMER2_ICR_R = TIMER_ICR_TATOCINT; // acknowledge interrupt flag
-	(*(HandlerTaskArray[4]))(); // start Timer2A task
+	if((timer < 0) || (timer >= TIMER_NUMTIMERS)){
+		return;
+	}
+	TIMER_Stop(timer);
+	HalfUsed[timer] = 0;
+	if(!HalfUsed[timer^1]){
+		ModuleMode[timer/2] = MODULE_UNUSED;
+	}
 }
 
-void Timer2B_Handler(void)
+// Read Timer Count in the timer
+unsigned long TIMER_ReadTimerValue(int timer)
 {
-	TIMER2_ICR_R = TIMER_ICR_TBTOCINT; // acknowledge interrupt flag
-	(*(HandlerTaskArray[5]))(); // start Timer2B task
+	if((timer < 0) || (timer >= TIMER_NUMTIMERS)){
+		return 0;
+	}
+	return TIMERHALFREG(&TimerTable[timer],TIMER_TXR); // a single read, no critical section needed
 }
 
-void Timer3A_Handler(void)
+
+// enables interrupts in the NVIC vector table
+// setting the bit enables the interrupt, trying to
+// clear the bit has no effect in disabling the interrupts
+// it requires setting the appropriate bits in the DIS Registers
+void TIMER_NVIC_EnableTimerInt(int timer)
 {
-	TIMER3_ICR_R = TIMER_ICR_TATOCINT; // acknowledge interrupt flag
-	(*(HandlerTaskArray[6]))(); // start Timer3A task
+	uint32_t irq;
+	if((timer < 0) || (timer >= TIMER_NUMTIMERS)){
+		return;
+	}
+	irq = TimerTable[timer].IRQ;
+	NVIC_EN_REG(irq) = 1<<(irq%32);
 }
 
-void Timer3B_Handler(void)
+// disables interrupts in the NVIC vector table
+// setting the bit disables the interrupt, trying to
+// clear the bit has no effect in re-enabling the interrupts
+// it requires setting the appropriate bits in the EN Registers
+void TIMER_NVIC_DisableTimerInt(int timer)
 {
-	TIMER3_ICR_R = TIMER_ICR_TBTOCINT; // acknowledge interrupt flag
-	(*(HandlerTaskArray[7]))(); // start Timer3B task
+	uint32_t irq;
+	if((timer < 0) || (timer >= TIMER_NUMTIMERS)){
+		return;
+	}
+	irq = TimerTable[timer].IRQ;
+	NVIC_DIS_REG(irq) = 1<<(irq%32);
 }
 
-void Timer4A_Handler(void)
+// starts counting and enables its interrupt in the NVIC
+void TIMER_Start(int timer)
 {
-	TIMER4_ICR_R = TIMER_ICR_TATOCINT; // acknowledge interrupt flag
-	(*(HandlerTaskArray[8]))(); // start Timer4A task
+	timerdescType *d;
+	if((timer < 0) || (timer >= TIMER_NUMTIMERS)){
+		return;
+	}
+	d = &TimerTable[timer];
+	TIMER_NVIC_EnableTimerInt(timer);
+	TIMERREG(d,TIMER_CTL) |= TIMERBIT(d,TIMER_CTL_TAEN);
 }
 
-void Timer4B_Handler(void)
+// stops counting and disables its interrupt in the NVIC
+void TIMER_Stop(int timer)
 {
-	TIMER4_ICR_R = TIMER_ICR_TBTOCINT; // acknowledge interrupt flag
-	(*(HandlerTaskArray[9]))(); // start Timer4B task
+	timerdescType *d;
+	if((timer < 0) || (timer >= TIMER_NUMTIMERS)){
+		return;
+	}
+	d = &TimerTable[timer];
+	TIMER_NVIC_DisableTimerInt(timer);
+	TIMERREG(d,TIMER_CTL) &= ~TIMERBIT(d,TIMER_CTL_TAEN);
 }
 
-void Timer5A_Handler(void)
+#ifdef PROFILE
+// bus cycles since the timer last timed out, read from the counter itself,
+// so it is the interrupt latency no matter how long the period is
+// a prescaled half only resolves whole prescaled counts
+static __inline unsigned long Timer_Elapsed(int timer)
 {
-	TIMER5_ICR_R = TIMER_ICR_TATOCINT; // acknowledge interrupt flag
-	(*(HandlerTaskArray[10]))(); // // start Timer5A task
+	timerdescType *d = &TimerTable[timer];
+	uint32_t now = TIMERHALFREG(d,TIMER_TXV);
+	if(!d->Wide && (ModuleMode[timer/2] == MODULE_SPLIT)){
+		now &= 0xFFFF; // bits 23:16 hold the prescaler
+	}
+	return (TIMERHALFREG(d,TIMER_TXILR) - now)*(TIMERHALFREG(d,TIMER_TXPR)+1);
 }
+#endif
 
-void Timer5B_Handler(void)
+// acknowledge the timeout and run the task, every timer handler is this
+// a dithered timer gets the length of the period after the one just started
+// with PROFILE, the latency and run time of every call go to OS_ProfileTask,
+// a one-shot timer has stopped at its timeout so only its run time counts
+static __inline void TIMER_Dispatch(int timer)
 {
-	TIMER5_ICR_R = TIMER_ICR_TBTOCINT; // acknowledge interrupt flag
-	(*(HandlerTaskArray[11]))(); // start Timer5B task
+	timerdescType *d = &TimerTable[timer];
+	struct timerdither *dither = &Dither[timer];
+#ifdef PROFILE
+	unsigned long latency = ((TIMERHALFREG(d,TIMER_TXMR)&TIMER_TAMR_TAMR_M) == TIMER_TAMR_TAMR_1_SHOT) ?
+	  OS_NOLATENCY : Timer_Elapsed(timer); // before the interval load changes
+	unsigned long start = OS_Time();
+	unsigned long isrStart = OS_IsrTime(); // interrupts nested in the task add to it
+#endif
+#ifdef TRACE
+	OS_Trace(TRACE_ISRENTER, d->IRQ+16); // exception number
+#endif
+	TIMERREG(d,TIMER_ICR) = TIMERBIT(d,TIMER_ICR_TATOCINT); // acknowledge interrupt flag
+	if(dither->Modulus != 0){
+		dither->Acc += dither->Step;
+		if(dither->Acc >= dither->Modulus){ // a whole count has built up
+			dither->Acc -= dither->Modulus;
+			TIMERHALFREG(d,TIMER_TXILR) = dither->Base;   // Base+1 counts
+		}else{
+			TIMERHALFREG(d,TIMER_TXILR) = dither->Base-1;
+		}
+	}
+	(*(HandlerTaskArray[timer]))(); // start the task
+#ifdef PROFILE
+	OS_ProfileTask(timer, latency, OS_TimeDifference(start, OS_Time()), isrStart);
+#endif
+#ifdef TRACE
+	OS_Trace(TRACE_ISREXIT, d->IRQ+16);
+#endif
 }
 
+void Timer0A_Handler(void){ TIMER_Dispatch(0); }
+void Timer0B_Handler(void){ TIMER_Dispatch(1); }
+void Timer1A_Handler(void){ TIMER_Dispatch(2); }
+void Timer1B_Handler(void){ TIMER_Dispatch(3); }
+void Timer2A_Handler(void){ TIMER_Dispatch(4); }
+void Timer2B_Handler(void){ TIMER_Dispatch(5); }
+void Timer3A_Handler(void){ TIMER_Dispatch(6); }
+void Timer3B_Handler(void){ TIMER_Dispatch(7); }
+void Timer4A_Handler(void){ TIMER_Dispatch(8); }
+void Timer4B_Handler(void){ TIMER_Dispatch(9); }
+void Timer5A_Handler(void){ TIMER_Dispatch(10); }
+void Timer5B_Handler(void){ TIMER_Dispatch(11); }
+void WideTimer0A_Handler(void){ TIMER_Dispatch(12); }
+void WideTimer0B_Handler(void){ TIMER_Dispatch(13); }
+void WideTimer1A_Handler(void){ TIMER_Dispatch(14); }
+void WideTimer1B_Handler(void){ TIMER_Dispatch(15); }
+void WideTimer2A_Handler(void){ TIMER_Dispatch(16); }
+void WideTimer2B_Handler(void){ TIMER_Dispatch(17); }
+void WideTimer3A_Handler(void){ TIMER_Dispatch(18); }
+void WideTimer3B_Handler(void){ TIMER_Dispatch(19); }
+void WideTimer4A_Handler(void){ TIMER_Dispatch(20); }
+void WideTimer4B_Handler(void){ TIMER_Dispatch(21); }
+void WideTimer5A_Handler(void){ TIMER_Dispatch(22); }
+void WideTimer5B_Handler(void){ TIMER_Dispatch(23); }
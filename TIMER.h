@@ -1,40 +1,67 @@
 //Timer.h
 
 #include <stdint.h>
-// these are stored in a buffer to easily start tasks by enabling the timer
-#define TIMER0_CTL_PTR_R            (volatile uint32_t *)0x4003000C
-#define TIMER1_CTL_PTR_R            (volatile uint32_t *)0x4003100C
-#define TIMER2_CTL_PTR_R            (volatile uint32_t *)0x4003200C
-#define TIMER3_CTL_PTR_R            (volatile uint32_t *)0x4003300C
-#define TIMER4_CTL_PTR_R            (volatile uint32_t *)0x4003400C
-#define TIMER5_CTL_PTR_R            (volatile uint32_t *)0x4003500C
+#include <stddef.h>
 	
 #define CLOCKSPEED_80MHZ			80000000 // 80 MHz
-#define CLOCKSPEED_50MHZ			80000000 // 80 MHz
 
+// 0-11 are Timer0A, Timer0B, ... Timer5B, 12-23 are WideTimer0A ... WideTimer5B
+#define TIMER_NUMTIMERS 24
 
-extern void(*HandlerTaskArray[12])(void);
-extern volatile unsigned int* timerCtrlBuf[12];
+extern void(*HandlerTaskArray[TIMER_NUMTIMERS])(void);
 extern void OS_DisableInterrupts(void); // Disable interrupts
 extern void OS_EnableInterrupts(void);  // Enable interrupts
 extern int32_t StartCritical(void);
 extern void EndCritical(int32_t primask);
+extern unsigned long OS_Time(void);
+extern unsigned long OS_TimeDifference(unsigned long start, unsigned long stop);
+extern void OS_ProfileTask(int task, unsigned long latency, unsigned long exec,
+  unsigned long isrStart);
+extern unsigned long OS_IsrTime(void);
+extern void OS_Trace(unsigned long event, unsigned long arg);
 
 
 
 
 
 
+// configures a timer for periodic interrupts that run task
+// period is in bus cycles (12.5ns)
+// an A half is one 32-bit timer unless its B half is in use, a B half is
+// split into 16 bits with a prescaler (32 bits on the wide timers)
+// returns 0 if successful, -1 if the timer does not exist, the period does
+// not fit, or the other half of the module is set up the other way
+int TIMER_TimerInit(void(*task)(void), int timer, unsigned long period, unsigned long priority);
 
-int TIMER_TimerInit(void(*task)(void), int timer, unsigned long desiredFrequency, unsigned long priority);
+// configures a timer for periodic interrupts at num/den Hz that run task
+// the period alternates between two lengths so the average rate is exact
+// achieved gets the long term rate in 0.001 Hz units, it can be NULL
+// returns 0 if successful, -1 as for TIMER_TimerInit or if PLL_BusClock
+// can not tell the bus clock
+int TIMER_TimerInitRate(void(*task)(void), int timer, unsigned long num, unsigned long den,
+  unsigned long priority, unsigned long *achieved);
+
+// marks the A half of a module as a 32-bit timer set up outside this driver
+// returns 0 if successful, -1 if the module is already in use
+int TIMER_Reserve(int timer);
+
+// stops a timer and lets its module be set up again
+void TIMER_TimerFree(int timer);
 
 void TIMER_ClearPeriodicTime(int timer);
 
+// Returns the number of bus cycles in a full period
 unsigned long TIMER_ReadTimerPeriod(int timer);
 
 // Read Timer Count in the timer																									
 unsigned long TIMER_ReadTimerValue(int timer);
 
+// starts counting and enables its interrupt in the NVIC
+void TIMER_Start(int timer);
+
+// stops counting and disables its interrupt in the NVIC
+void TIMER_Stop(int timer);
+
 
 // enables interrupts in the NVIC vector table
 // setting the bit enables the interrupt, trying to
@@ -47,4 +74,3 @@ void TIMER_NVIC_EnableTimerInt(int timer);
 // clear the bit has no effect in re-enabling the interrupts
 // it requires setting the appropriate bits in the EN Registers
 void TIMER_NVIC_DisableTimerInt(int timer);
-
@@ -32,6 +32,7 @@
 
 #include "FIFO.h"
 #include "UART.h"
+#include "OS.h"
 
 #define NVIC_EN0_INT5           0x00000020  // Interrupt 5 enable
 
@@ -70,6 +71,8 @@ void WaitForInterrupt(void);  // low power mode
                               // create index implementation FIFO (see FIFO.h)
 AddIndexFifo(Rx, FIFOSIZE, char, FIFOSUCCESS, FIFOFAIL)
 AddIndexFifo(Tx, FIFOSIZE, char, FIFOSUCCESS, FIFOFAIL)
+Sema4Type RxDataAvailable;            // number of characters in RxFifo
+Sema4Type TxRoomLeft;                 // number of free spots in TxFifo
 
 // Initialize UART0
 // Baud rate is 115200 bits/sec
@@ -78,6 +81,8 @@ void UART_Init(void){
   SYSCTL_RCGCGPIO_R |= 0x01;            // activate port A
   RxFifo_Init();                        // initialize empty FIFOs
   TxFifo_Init();
+  OS_InitSemaphore(&RxDataAvailable, 0);
+  OS_InitSemaphore(&TxRoomLeft, FIFOSIZE);
   UART0_CTL_R &= ~UART_CTL_UARTEN;      // disable UART
   UART0_IBRD_R = 43;                    // IBRD = int(80,000,000 / (16 * 115,200)) = int(43.402778)
   UART0_FBRD_R = 26;                     // FBRD = int(0..402778 * 64 + 0.5) = 26
@@ -107,6 +112,7 @@ void static copyHardwareToSoftware(void){
   while(((UART0_FR_R&UART_FR_RXFE) == 0) && (RxFifo_Size() < (FIFOSIZE - 1))){
     letter = UART0_DR_R;
     RxFifo_Put(letter);
+    OS_Signal(&RxDataAvailable);        // wake up a thread blocked in UART_InChar
   }
 }
 // copy from software TX FIFO to hardware TX FIFO
@@ -116,19 +122,22 @@ void static copySoftwareToHardware(void){
   while(((UART0_FR_R&UART_FR_TXFF) == 0) && (TxFifo_Size() > 0)){
     TxFifo_Get(&letter);
     UART0_DR_R = letter;
+    OS_Signal(&TxRoomLeft);             // wake up a thread blocked in UART_OutChar
   }
 }
 // input ASCII character from UART
-// spin if RxFifo is empty
+// block if RxFifo is empty
 char UART_InChar(void){
   char letter;
-  while(RxFifo_Get(&letter) == FIFOFAIL){};
+  OS_Wait(&RxDataAvailable);
+  RxFifo_Get(&letter);
   return(letter);
 }
 // output ASCII character to UART
-// spin if TxFifo is full
+// block if TxFifo is full
 void UART_OutChar(char data){
-  while(TxFifo_Put(data) == FIFOFAIL){};
+  OS_Wait(&TxRoomLeft);
+  TxFifo_Put(data);
   UART0_IM_R &= ~UART_IM_TXIM;          // disable TX FIFO interrupt
   copySoftwareToHardware();
   UART0_IM_R |= UART_IM_TXIM;           // enable TX FIFO interrupt
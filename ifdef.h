@@ -5,3 +5,6 @@
 #define INTERPRETER
 #define DEBUG
 #define SYSTICK
+#define TICKLESS   // idle thread skips SysTick interrupts until the next wakeup, needs SYSTICK
+//#define PROFILE  // time the latency and run time of every timer task, see Jitter()
+//#define TRACE    // scheduler event trace buffer, dumped by the interpreter trace command
@@ -29,6 +29,7 @@
         PRESERVE8
 
         EXTERN  RunPt            ; currently running thread
+        EXTERN  Scheduler        ; sets RunPt to the next thread to run
         EXPORT  OS_DisableInterrupts
         EXPORT  OS_EnableInterrupts
         EXPORT  StartOS
@@ -53,15 +54,12 @@ PendSV_Handler
     LDR     R1, [R0]           ;    R1 = RunPt
     STR     SP, [R1]           ; 5) Save SP into TCB
 	
-	; this skips sleeping threads
-sleeping					   ; KL & DA pg 189 
-	LDR R1, [R1,#4]			   ; R1 = RunPt, [R1,#4] = RunPt->next
-	LDR R2, [R1, #16]          ; [R1, #16] = RunPt->SleepCtr
-	CMP	R2,	#0                 ; if sleeping skip, go to RunPt->next until SleepCtr == 0
-	BNE	sleeping
-	; end of our added routine
-	
-    STR     R1, [R0]           ;    RunPt = R1
+	; pick the highest priority ready thread, sleeping and
+	; blocked threads are not in the ready lists so none are skipped here
+    PUSH    {R0,LR}            ; 6) save R0 and EXC_RETURN across the call
+    BL      Scheduler          ;    RunPt = next thread
+    POP     {R0,LR}
+    LDR     R1, [R0]           ;    R1 = RunPt, new thread
     LDR     SP, [R1]           ; 7) new thread SP; SP = RunPt->sp;
     POP     {R4-R11}           ; 8) restore regs r4-11
     CPSIE   I                  ; 9) tasks run with interrupts enabled
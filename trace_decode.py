@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+# trace_decode.py
+# decodes the binary dump of the interpreter "trace" command (OS_TraceDump)
+# into an event listing and a text timeline of which thread ran when
+#
+# capture the dump with any terminal that can log raw bytes to a file, or
+# read the serial port directly if pyserial is installed:
+#   python3 trace_decode.py capture.bin
+#   python3 trace_decode.py --port /dev/ttyACM0   (then type trace)
+
+import argparse
+import struct
+import sys
+
+MAGIC = b"TRCE"
+CLOCK = 80000000  # bus clock, OS_Time counts at this rate
+
+EVENTS = ["switch", "isr enter", "isr exit", "wait", "block", "signal",
+          "fifo put", "fifo get", "user"]
+SWITCH, ISRENTER, ISREXIT = 0, 1, 2
+
+# exception numbers the OS traces, IRQ+16
+EXCEPTIONS = {15: "SysTick", 35: "Timer0A", 36: "Timer0B", 37: "Timer1A",
+              38: "Timer1B", 39: "Timer2A", 40: "Timer2B", 46: "GPIOPortF",
+              51: "Timer3A", 52: "Timer3B", 86: "Timer4A", 87: "Timer4B",
+              108: "Timer5A", 109: "Timer5B"}
+for n in range(12):
+    EXCEPTIONS[110 + n] = "WideTimer%d%s" % (n // 2, "AB"[n % 2])
+
+
+def read_dump(data):
+    """returns (idle slot, [(time, event, thread, arg)]) of the last dump"""
+    at = data.rfind(MAGIC)
+    if at < 0:
+        sys.exit("no trace dump found")
+    version, idle, count = struct.unpack_from("<BBH", data, at + 4)
+    if version != 1:
+        sys.exit("unknown trace version %d" % version)
+    body = data[at + 8:]
+    if len(body) < 8 * count:
+        sys.exit("dump cut short, %d of %d records" % (len(body) // 8, count))
+    records = []
+    high = 0
+    last = None
+    for i in range(count):
+        time, event, thread, arg = struct.unpack_from("<IBBH", body, 8 * i)
+        if last is not None and time < last and last - time > 1 << 31:
+            high += 1 << 32  # OS_Time wrapped, records are under 26 s apart
+        # a small step back is two records an interrupt wrote out of order
+        last = time
+        records.append((high + time, event, thread, arg))
+    if records:
+        start = records[0][0]
+        records = [(t - start, e, th, a) for (t, e, th, a) in records]
+    return idle, records
+
+
+def thread_name(slot, idle):
+    return "idle" if slot == idle else "T%d" % slot
+
+
+def arg_text(event, arg):
+    if event in (ISRENTER, ISREXIT):
+        return EXCEPTIONS.get(arg, "exception %d" % arg)
+    if event in (3, 4, 5):
+        return "sema 0x%04X" % arg
+    return str(arg)
+
+
+def listing(idle, records):
+    for time, event, thread, arg in records:
+        name = EVENTS[event] if event < len(EVENTS) else "event %d" % event
+        if event == SWITCH:
+            text = "%s -> %s" % (thread_name(arg, idle), thread_name(thread, idle))
+        else:
+            text = "%-9s %s" % (name, arg_text(event, arg))
+        print("%12.1f us  %-5s %s" % (time * 1e6 / CLOCK, thread_name(thread, idle), text))
+
+
+def timeline(idle, records, width):
+    """one row per thread, a # where it was running, ! where an ISR ran"""
+    if len(records) < 2:
+        return
+    end = records[-1][0] or 1
+    rows = {}
+    running = records[0][2]
+    since = 0
+    column = lambda t: min(width - 1, t * width // end)
+    isr = [" "] * width
+
+    def mark(slot, t0, t1):
+        row = rows.setdefault(slot, [" "] * width)
+        for c in range(column(t0), column(t1) + 1):
+            row[c] = "#"
+
+    for time, event, thread, arg in records:
+        if event == SWITCH:
+            mark(running, since, time)
+            running, since = thread, time
+        elif event == ISRENTER:
+            isr[column(time)] = "!"
+    mark(running, since, end)
+    print("\n0 us%s%.1f us" % (" " * (width - 4), end * 1e6 / CLOCK))
+    for slot in sorted(rows):
+        print("%-5s|%s|" % (thread_name(slot, idle), "".join(rows[slot])))
+    print("%-5s|%s|" % ("isr", "".join(isr)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="decode an OS_TraceDump capture")
+    parser.add_argument("file", nargs="?", help="raw capture of the dump")
+    parser.add_argument("--port", help="read the dump from this serial port")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--width", type=int, default=100, help="timeline columns")
+    args = parser.parse_args()
+    if args.port:
+        import serial  # pyserial
+        with serial.Serial(args.port, args.baud, timeout=2) as port:
+            data = b""
+            while True:
+                chunk = port.read(4096)
+                if not chunk and MAGIC in data:
+                    break
+                data += chunk
+    elif args.file:
+        with open(args.file, "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    idle, records = read_dump(data)
+    listing(idle, records)
+    timeline(idle, records, args.width)
+
+
+if __name__ == "__main__":
+    main()